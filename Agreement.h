@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Lexicon.h"
+#include "Tag.h"
+
+/*
+ * Optional agreement pass over a sentence (--agree). Every nominal analysis
+ * is one bit of case, number and gender (42 bits, Inflection * 3 + Gender),
+ * a noun taking its lemma's gender; a token's mask is the union of its
+ * analyses' bits. Where an adjective can stand next to a nominal, the pair's
+ * masks are intersected and nominal analyses outside the intersection are
+ * dropped from both. A token already restricted by its left neighbour keeps
+ * that restriction when its right neighbour does not agree with it. Verb
+ * analyses are never dropped. One pass, linear in the sentence length.
+ */
+
+inline const uint64_t agreementBit(const Inflection &i, const Gender &g)
+{
+	return (uint64_t)1 << (i * 3 + g);
+}
+
+// 0 for analyses that do not agree in case, number and gender.
+inline const uint64_t agreementBits(const Lexicon &lexicon, const Node &n)
+{
+	switch (tagType(n.tag)) {
+		case NOUN:
+			return agreementBit(nounQuery(n.tag).i, lexicon.nouns[lexicon.refs[n.lemma].index].gender);
+		case ADJECTIVE: {
+			auto q = adjQuery(n.tag);
+			return agreementBit(q.i, q.g);
+		}
+		default:
+			return 0;
+	}
+}
+
+inline void disambiguate(const Lexicon &lexicon, std::vector<std::vector<Analysis>> *sentence)
+{
+	const size_t n = sentence->size();
+	std::vector<uint64_t> masks(n, 0);
+	std::vector<bool> adjective(n, false);
+	for (size_t i = 0; i < n; i++) {
+		for (auto &a : (*sentence)[i]) {
+			masks[i] |= agreementBits(lexicon, a.node);
+			adjective[i] = adjective[i] || tagType(a.node.tag) == ADJECTIVE;
+		}
+	}
+
+	std::vector<uint64_t> allowed = masks;
+	for (size_t i = 0; i + 1 < n; i++) {
+		if (!adjective[i] && !adjective[i + 1])
+			continue;
+		uint64_t common = masks[i] & masks[i + 1];
+		if (common == 0)
+			continue;
+		if (allowed[i] & common)
+			allowed[i] &= common;
+		if (allowed[i + 1] & common)
+			allowed[i + 1] &= common;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		if (allowed[i] == masks[i])
+			continue;
+		auto &analyses = (*sentence)[i];
+		analyses.erase(std::remove_if(analyses.begin(), analyses.end(), [&](const Analysis &a) {
+			uint64_t bits = agreementBits(lexicon, a.node);
+			return bits != 0 && (bits & allowed[i]) == 0;
+		}), analyses.end());
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Blocked Bloom filter: a key's bits all fall inside one 512-bit block, so
+ * a probe touches a single cache line. With the default 10 bits per key and
+ * 7 bits per probe the false positive rate is around 1%.
+ */
+struct BloomFilter
+{
+	std::vector<uint64_t> words;
+	uint64_t blocks = 0;
+};
+
+const int BLOOM_WORDS = 8;
+const int BLOOM_PROBES = 7;
+
+inline const uint64_t hashSeries(const std::string_view &s)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (auto &c : s) {
+		h ^= (uint8_t)c;
+		h *= 0x100000001b3ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+inline const BloomFilter buildBloom(const std::vector<std::string> &keys, const size_t &bitsPerKey = 10)
+{
+	BloomFilter bloom;
+	bloom.blocks = std::max<uint64_t>(1, (keys.size() * bitsPerKey + 511) / 512);
+	bloom.words.assign(bloom.blocks * BLOOM_WORDS, 0);
+	for (auto &k : keys) {
+		uint64_t h = hashSeries(k);
+		uint64_t *block = &bloom.words[(h % bloom.blocks) * BLOOM_WORDS];
+		uint32_t a = h >> 32;
+		uint32_t b = (uint32_t)h | 1;
+		for (int i = 0; i < BLOOM_PROBES; i++) {
+			uint32_t bit = (a + i * b) & 511;
+			block[bit >> 6] |= (uint64_t)1 << (bit & 63);
+		}
+	}
+	return bloom;
+}
+
+inline const bool bloomContains(const BloomFilter &bloom, const std::string_view &key)
+{
+	if (bloom.blocks == 0)
+		return true;
+	uint64_t h = hashSeries(key);
+	const uint64_t *block = &bloom.words[(h % bloom.blocks) * BLOOM_WORDS];
+	uint32_t a = h >> 32;
+	uint32_t b = (uint32_t)h | 1;
+	for (int i = 0; i < BLOOM_PROBES; i++) {
+		uint32_t bit = (a + i * b) & 511;
+		if (!(block[bit >> 6] & ((uint64_t)1 << (bit & 63))))
+			return false;
+	}
+	return true;
+}
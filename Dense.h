@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Packed.h"
+#include "Search.h"
+
+// Number of trie levels given direct-indexed child tables unless overridden
+// at run time with --dense-depth.
+#ifndef LEMMA_DENSE_DEPTH
+#define LEMMA_DENSE_DEPTH 2
+#endif
+
+/*
+ * Flat child tables over the top levels of a SearchMap. Characters are
+ * remapped to dense symbol ids (0 for characters never seen in the trie)
+ * and every node above the cutoff gets one row of `alphabet` entries, so a
+ * step is a single array index. Rows hold dense node ids, with 0 (the root,
+ * which is nobody's child) marking a missing child; nodes[] maps each dense
+ * node back to its SearchMap, from where deeper levels are walked as usual.
+ */
+struct DenseTrie
+{
+	uint8_t symbols[256] = { 0 };
+	uint32_t alphabet = 1;
+	uint32_t depth = 0;
+	std::vector<uint32_t> table;
+	std::vector<const SearchMap *> nodes;
+};
+
+inline void collectAlphabet(const SearchMap *map, bool *seen)
+{
+	for (size_t i = 0; i < map->next.size(); i++) {
+		seen[(uint8_t)childLabel(map, i)] = true;
+		collectAlphabet(&map->next[i], seen);
+	}
+}
+
+inline const DenseTrie buildDense(const SearchMap *root, const uint32_t &depth)
+{
+	DenseTrie dense;
+	dense.depth = depth;
+	bool seen[256] = { false };
+	collectAlphabet(root, seen);
+	for (int c = 0; c < 256; c++) {
+		if (seen[c])
+			dense.symbols[c] = dense.alphabet++;
+	}
+
+	// Breadth first, so that all nodes with a row come before the others.
+	dense.nodes.push_back(root);
+	size_t level = 0;
+	size_t levelEnd = 1;
+	for (size_t n = 0; n < dense.nodes.size() && level < depth; n++) {
+		auto map = dense.nodes[n];
+		dense.table.resize((n + 1) * dense.alphabet, 0);
+		for (size_t i = 0; i < map->next.size(); i++) {
+			dense.table[n * dense.alphabet + dense.symbols[(uint8_t)childLabel(map, i)]] = dense.nodes.size();
+			dense.nodes.push_back(&map->next[i]);
+		}
+		if (n + 1 == levelEnd) {
+			level++;
+			levelEnd = dense.nodes.size();
+		}
+	}
+	return dense;
+}
+
+// Steps from dense node `node` along c; returns 0 when there is no child.
+inline const uint32_t denseStep(const DenseTrie &dense, const uint32_t &node, const char &c)
+{
+	uint8_t sym = dense.symbols[(uint8_t)c];
+	if (sym == 0)
+		return 0;
+	return dense.table[node * dense.alphabet + sym];
+}
+
+inline const SearchMap *searchSequenceExact(const series_t &s, const DenseTrie &dense)
+{
+	uint32_t node = 0;
+	size_t i = 0;
+	for (; i < s.size() && i < dense.depth; i++) {
+		node = denseStep(dense, node, s[i]);
+		if (node == 0)
+			return NULL;
+	}
+	auto current = dense.nodes[node];
+	for (; i < s.size(); i++) {
+		current = findChild(current, s[i]);
+		if (current == NULL)
+			return NULL;
+	}
+	if (hasAnalyses(current))
+		return current;
+	return NULL;
+}
+
+inline const size_t denseBytes(const DenseTrie &dense)
+{
+	return sizeof(DenseTrie) + dense.table.capacity() * sizeof(uint32_t) + dense.nodes.capacity() * sizeof(const SearchMap *);
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Filter.h"
+#include "Search.h"
+
+/*
+ * Comparatives, superlatives and participles are derived from a base lemma
+ * by a fixed rule: a stem plus one of a handful of adjective paradigms. Their
+ * forms are not put in the trie. Each derived lemma is indexed once under the
+ * longest prefix shared by all its forms, with an ending table listing the
+ * rest of every form and its tag; a lookup walks the stem index along the
+ * word and checks the remainder against the tables of the stems it passes.
+ * Lemmas following the same rule share one table.
+ */
+struct EndingTable
+{
+	// sorted by ending; equal endings stay in slot order
+	std::vector<std::pair<series_t, tag_t>> endings;
+	uint64_t features = 0;
+};
+
+struct DerivedIndex
+{
+	// Node::lemma is the derived lemma, Node::tag its ending table.
+	SearchMap stems;
+	std::vector<EndingTable> tables;
+	// table ids by hashEndings, to find a lemma's table among those shared
+	std::unordered_map<size_t, std::vector<tag_t>> tableIds;
+	// weights of single analyses of derived lemmas; lemma weights are kept
+	// in the stem nodes
+	std::unordered_map<uint64_t, uint16_t> weights;
+};
+
+inline const size_t hashEndings(const std::vector<std::pair<series_t, tag_t>> &endings)
+{
+	size_t h = endings.size();
+	for (auto &e : endings) {
+		h = h * 31 + std::hash<series_t>()(e.first);
+		h = h * 31 + e.second;
+	}
+	return h;
+}
+
+// forms holds the lemma's forms with their tags in slot order, "*" for
+// missing ones. Table ids are kept in Node::tag, so a lemma needing a new
+// table once there are 65536 is not indexed; returns false for it.
+inline const bool addDerived(DerivedIndex *index, const lemma_id_t &id, const std::vector<std::pair<series_t, tag_t>> &forms)
+{
+	std::string_view stem;
+	bool first = true;
+	for (auto &f : forms) {
+		if (f.first == "*")
+			continue;
+		if (first) {
+			stem = f.first;
+			first = false;
+		}
+		size_t n = 0;
+		while (n < stem.size() && n < f.first.size() && stem[n] == f.first[n])
+			n++;
+		stem = stem.substr(0, n);
+	}
+	if (first)
+		return true;
+
+	EndingTable table;
+	for (auto &f : forms) {
+		if (f.first == "*")
+			continue;
+		table.endings.push_back({ f.first.substr(stem.size()), f.second });
+		// derived lemmas are adjectives, whose gender is in the tag
+		table.features |= featureBits(f.second, G_MAS);
+	}
+	std::stable_sort(table.endings.begin(), table.endings.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+	auto &ids = index->tableIds[hashEndings(table.endings)];
+	auto t = std::find_if(ids.begin(), ids.end(), [&](const tag_t &t) { return index->tables[t].endings == table.endings; });
+	if (t == ids.end()) {
+		if (index->tables.size() > UINT16_MAX)
+			return false;
+		t = ids.insert(ids.end(), (tag_t)index->tables.size());
+		index->tables.push_back(table);
+	}
+
+	auto current = &index->stems;
+	for (auto &c : stem)
+		current = addChild(current, c);
+	current->lemmas.push_back(Node(id, *t));
+	return true;
+}
+
+// Calls emit(Node) for every analysis of s as a form of a derived lemma that
+// passes filter, in slot order per lemma.
+template<typename F>
+void matchDerived(const DerivedIndex &index, const std::string_view &s, F &&emit, const FeatureFilter &filter = FeatureFilter())
+{
+	auto current = &index.stems;
+	for (size_t k = 0;; k++) {
+		auto ending = s.substr(k);
+		for (auto &n : current->lemmas) {
+			auto &table = index.tables[n.tag];
+			if (!allowsLemma(filter, n.lemma) || !mayMatch(filter, table.features))
+				continue;
+			auto &endings = table.endings;
+			auto it = std::lower_bound(endings.begin(), endings.end(), ending, [](const auto &e, const std::string_view &x) { return std::string_view(e.first) < x; });
+			for (; it != endings.end() && it->first == ending; it++) {
+				if (!filter.groups.empty() && !mayMatch(filter, featureBits(it->second, G_MAS)))
+					continue;
+				Node m(n.lemma, it->second);
+				m.weight = n.weight;
+				if (!index.weights.empty()) {
+					auto w = index.weights.find(nodeKey(m));
+					if (w != index.weights.end())
+						m.weight = w->second;
+				}
+				emit(m);
+			}
+		}
+		if (k == s.size())
+			break;
+		current = findChild(current, s[k]);
+		if (current == NULL)
+			break;
+	}
+}
+
+inline void collectDerivedForms(const DerivedIndex &index, const SearchMap *map, series_t *prefix, std::vector<series_t> *forms)
+{
+	for (auto &n : map->lemmas) {
+		for (auto &e : index.tables[n.tag].endings)
+			forms->push_back(*prefix + e.first);
+	}
+	for (size_t i = 0; i < map->next.size(); i++) {
+		prefix->push_back(childLabel(map, i));
+		collectDerivedForms(index, &map->next[i], prefix, forms);
+		prefix->pop_back();
+	}
+}
+
+// Every form of every derived lemma; the same form may appear more than once.
+inline const std::vector<series_t> derivedForms(const DerivedIndex &index)
+{
+	std::vector<series_t> forms;
+	series_t prefix;
+	collectDerivedForms(index, &index.stems, &prefix, &forms);
+	return forms;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Search.h"
+#include "Tag.h"
+
+/*
+ * Feature filters for lookups. An analysis is described by a 64-bit set with
+ * one bit per value of each feature that applies to it (a noun has no mood,
+ * an infinitive no person); nouns take the gender of their lemma, which the
+ * tag does not carry, so callers pass it in. A filter allows a set of values
+ * per feature; an analysis matches when, for every feature the filter
+ * constrains, one of its bits is allowed. Trie nodes keep the union of their
+ * analyses' sets, which passes the same test whenever any of the analyses
+ * could, so a node failing it is skipped whole.
+ */
+
+enum FeatureGroupId
+{
+	F_POS,
+	F_NUMBER,
+	F_CASE,
+	F_GENDER,
+	F_PERSON,
+	F_DEGREE,
+	F_MOOD,
+	F_VOICE,
+	F_TENSE,
+	FEATURE_GROUPS
+};
+
+const int FEATURE_SHIFT[FEATURE_GROUPS] = { 0, 3, 5, 12, 15, 18, 21, 25, 27 };
+const int FEATURE_VALUES[FEATURE_GROUPS] = { 3, 2, 7, 3, 3, 3, 4, 2, 6 };
+
+struct FeatureGroup
+{
+	const char *name;
+	std::vector<std::string> values;
+};
+
+// Names for parseFilter, values in the order of their enums.
+inline const std::vector<FeatureGroup> &featureGroups()
+{
+	static const std::vector<FeatureGroup> groups = {
+		{ "pos", { "N", "A", "V" } },
+		{ "number", { "SG", "PL" } },
+		{ "case", { "NOM", "GEN", "DAT", "ACC", "ABL", "VOC", "LOC" } },
+		{ "gender", { "M", "N", "F" } },
+		{ "person", { "1", "2", "3" } },
+		{ "degree", { "POS", "COMP", "SUPR" } },
+		{ "mood", { "INF", "IMP", "IND", "SUB" } },
+		{ "voice", { "ACT", "PAS" } },
+		{ "tense", { "PRE", "IMP", "FUT", "PRF", "PLU", "FPR" } }
+	};
+	return groups;
+}
+
+inline const uint64_t featureBit(const FeatureGroupId &g, const int &value)
+{
+	return (uint64_t)1 << (FEATURE_SHIFT[g] + value);
+}
+
+inline const uint64_t groupBits(const FeatureGroupId &g)
+{
+	return (((uint64_t)1 << FEATURE_VALUES[g]) - 1) << FEATURE_SHIFT[g];
+}
+
+// gender is the lemma's for nouns and ignored otherwise.
+inline const uint64_t featureBits(const tag_t &t, const Gender &gender)
+{
+	uint64_t bits = featureBit(F_POS, tagType(t));
+	switch (tagType(t)) {
+		case NOUN:
+			return bits | featureBit(F_NUMBER, tagNumber(t)) | featureBit(F_CASE, tagCase(t)) | featureBit(F_GENDER, gender);
+		case ADJECTIVE:
+			return bits | featureBit(F_NUMBER, tagNumber(t)) | featureBit(F_CASE, tagCase(t)) | featureBit(F_GENDER, tagGender(t)) | featureBit(F_DEGREE, tagDegree(t));
+		case VERB:
+			bits |= featureBit(F_MOOD, tagMood(t)) | featureBit(F_VOICE, tagVoice(t)) | featureBit(F_TENSE, tagTense(t));
+			if (tagPerson(t) != 0)
+				bits |= featureBit(F_PERSON, tagPerson(t) - 1) | featureBit(F_NUMBER, tagNumber(t));
+			return bits;
+		default:
+			return bits;
+	}
+}
+
+struct FeatureFilter
+{
+	uint64_t allowed = ~(uint64_t)0;
+	// groupBits of every constrained feature
+	std::vector<uint64_t> groups;
+	// empty for any lemma
+	std::vector<lemma_id_t> lemmas;
+};
+
+inline const bool unfiltered(const FeatureFilter &filter)
+{
+	return filter.groups.empty() && filter.lemmas.empty();
+}
+
+// Also the test for a node's union of feature sets.
+inline const bool mayMatch(const FeatureFilter &filter, const uint64_t &features)
+{
+	for (auto &g : filter.groups) {
+		if ((features & filter.allowed & g) == 0)
+			return false;
+	}
+	return true;
+}
+
+inline const bool allowsLemma(const FeatureFilter &filter, const lemma_id_t &id)
+{
+	return filter.lemmas.empty() || std::find(filter.lemmas.begin(), filter.lemmas.end(), id) != filter.lemmas.end();
+}
+
+// gender as for featureBits.
+inline const bool matches(const FeatureFilter &filter, const Node &n, const Gender &gender)
+{
+	return allowsLemma(filter, n.lemma) && (filter.groups.empty() || mayMatch(filter, featureBits(n.tag, gender)));
+}
+
+/*
+ * Parses a filter of comma separated constraints, each a feature and the
+ * values it may take separated by '|', e.g. "pos=V,mood=IND|SUB" or
+ * "case=ABL,number=PL"; lemma=<headword> (as written in the data files)
+ * restricts to a lemma. Returns false with a message on error.
+ */
+inline const bool parseFilter(const std::unordered_map<series_t, std::vector<lemma_id_t>> &headwords, const std::string &spec, FeatureFilter *filter, std::string *error)
+{
+	std::stringstream constraints(spec);
+	std::string constraint;
+	while (std::getline(constraints, constraint, ',')) {
+		auto eq = constraint.find('=');
+		if (eq == std::string::npos) {
+			*error = "Expected feature=value in " + constraint;
+			return false;
+		}
+		auto name = constraint.substr(0, eq);
+		std::stringstream values(constraint.substr(eq + 1));
+		std::string value;
+		if (name == "lemma") {
+			while (std::getline(values, value, '|')) {
+				auto it = headwords.find(value);
+				if (it == headwords.end()) {
+					*error = "Unknown headword " + value;
+					return false;
+				}
+				filter->lemmas.insert(filter->lemmas.end(), it->second.begin(), it->second.end());
+			}
+			continue;
+		}
+		auto &groups = featureGroups();
+		int g = 0;
+		while (g < FEATURE_GROUPS && groups[g].name != name)
+			g++;
+		if (g == FEATURE_GROUPS) {
+			*error = "Unknown feature " + name;
+			return false;
+		}
+		uint64_t allowed = 0;
+		while (std::getline(values, value, '|')) {
+			auto v = std::find(groups[g].values.begin(), groups[g].values.end(), value);
+			if (v == groups[g].values.end()) {
+				*error = "Unknown " + name + " " + value;
+				return false;
+			}
+			allowed |= featureBit((FeatureGroupId)g, v - groups[g].values.begin());
+		}
+		auto bits = groupBits((FeatureGroupId)g);
+		filter->allowed = (filter->allowed & ~bits) | allowed;
+		if (std::find(filter->groups.begin(), filter->groups.end(), bits) == filter->groups.end())
+			filter->groups.push_back(bits);
+	}
+	return true;
+}
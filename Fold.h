@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+/*
+ * Orthographic folding shared by everything that indexes or probes forms by
+ * spelling alone: long vowels lose their length (A -> a, ..., Y -> y, and the
+ * UTF-8 macron vowels likewise), v -> u and j -> i. Every candidate that
+ * generatePossibilities derives from a token folds to the same key as the
+ * token itself.
+ */
+
+// Reads a UTF-8 macron vowel at the start of s as its long grapheme.
+inline const char parseMacron(const std::string_view &s)
+{
+	if (s.size() < 2)
+		return 0;
+	unsigned char a = s[0];
+	unsigned char b = s[1] | 1;
+	if (a == 0xC4 && b == 0x81)
+		return 'A';
+	if (a == 0xC4 && b == 0x93)
+		return 'E';
+	if (a == 0xC4 && b == 0xAB)
+		return 'I';
+	if (a == 0xC5 && b == 0x8D)
+		return 'O';
+	if (a == 0xC5 && b == 0xAB)
+		return 'U';
+	if (a == 0xC8 && b == 0xB3)
+		return 'Y';
+	return 0;
+}
+
+inline const char foldGrapheme(const char &c)
+{
+	switch (c) {
+		case 'A':
+			return 'a';
+		case 'E':
+			return 'e';
+		case 'I':
+		case 'j':
+			return 'i';
+		case 'O':
+			return 'o';
+		case 'U':
+		case 'v':
+			return 'u';
+		case 'Y':
+			return 'y';
+		default:
+			return c;
+	}
+}
+
+// Folds s into out (which must hold s.size() bytes) and returns the folded
+// length.
+inline const size_t foldSeries(const std::string_view &s, char *out)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < s.size(); i++) {
+		if (char g = parseMacron(s.substr(i))) {
+			out[n++] = foldGrapheme(g);
+			i++;
+		} else {
+			out[n++] = foldGrapheme(s[i]);
+		}
+	}
+	return n;
+}
+
+inline const std::string foldSeries(const std::string_view &s)
+{
+	std::string out(s.size(), '\0');
+	out.resize(foldSeries(s, &out[0]));
+	return out;
+}
+
+// The graphemes the first letter of typed text s may stand for, in the order
+// generatePossibilities tries them: unmarked vowels leave length open and
+// i/j, u/v are one letter; a macron vowel or any other byte stands for
+// itself. *consumed is set to the bytes read; g is storage for the result.
+inline const std::string_view spellingOptions(const std::string_view &s, size_t *consumed, char *g)
+{
+	*consumed = 1;
+	if ((*g = parseMacron(s))) {
+		*consumed = 2;
+		return std::string_view(g, 1);
+	}
+	switch (s[0]) {
+		case 'a':
+			return "aA";
+		case 'e':
+			return "eE";
+		case 'i':
+		case 'j':
+			return "iI";
+		case 'o':
+			return "oO";
+		case 'u':
+		case 'v':
+			return "uUv";
+		case 'y':
+			return "yY";
+		default:
+			*g = s[0];
+			return std::string_view(g, 1);
+	}
+}
+
+// Where grapheme c of a spelling comes among the options of its folded
+// letter. Spellings sharing a fold compare in generatePossibilities order
+// when compared rank by rank.
+inline const size_t spellingRank(const char &c)
+{
+	char folded = foldGrapheme(c);
+	size_t consumed;
+	char g;
+	auto options = spellingOptions(std::string_view(&folded, 1), &consumed, &g);
+	return std::min(options.find(c), options.size());
+}
+
+// Whether spelling is among the candidates of typed text s.
+inline const bool spellsText(const std::string_view &s, const std::string_view &spelling)
+{
+	size_t k = 0;
+	for (size_t i = 0; i < s.size(); k++) {
+		size_t consumed;
+		char g;
+		auto options = spellingOptions(s.substr(i), &consumed, &g);
+		if (k == spelling.size() || options.find(spelling[k]) == std::string_view::npos)
+			return false;
+		i += consumed;
+	}
+	return k == spelling.size();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Fold.h"
+#include "Search.h"
+
+/*
+ * Secondary index of forms by their folded spelling (Fold.h). A token folds
+ * to the same key as every candidate generatePossibilities would try for it,
+ * so one probe finds the forms it may be; those are then checked letter by
+ * letter against the token, since a macron written in the token pins the
+ * vowel's length. Each key's forms are kept in candidate order, so matches
+ * come out in the order the expanded candidates would have been tried.
+ */
+struct FoldedIndex
+{
+	// first form and count per key
+	std::unordered_map<std::string, std::pair<uint32_t, uint32_t>> keys;
+	std::vector<series_t> forms;
+};
+
+// Compares two spellings of one key in generatePossibilities order.
+inline const bool candidateOrder(const std::string_view &a, const std::string_view &b)
+{
+	for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+		size_t ra = spellingRank(a[i]);
+		size_t rb = spellingRank(b[i]);
+		if (ra != rb)
+			return ra < rb;
+	}
+	return a.size() < b.size();
+}
+
+// forms need not be unique.
+inline const FoldedIndex buildFoldedIndex(std::vector<series_t> forms)
+{
+	std::vector<std::pair<std::string, series_t>> entries;
+	for (auto &f : forms)
+		entries.push_back({ foldSeries(f), std::move(f) });
+	std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+		return a.first != b.first ? a.first < b.first : candidateOrder(a.second, b.second);
+	});
+	entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+	FoldedIndex index;
+	for (auto &e : entries) {
+		auto &range = index.keys.try_emplace(e.first, index.forms.size(), 0).first->second;
+		range.second++;
+		index.forms.push_back(std::move(e.second));
+	}
+	return index;
+}
+
+// Calls emit(const series_t &) with every indexed form that text may be
+// spelling, in candidate order; key is text folded.
+template<typename F>
+void matchFolded(const FoldedIndex &index, const std::string_view &text, const std::string &key, F &&emit)
+{
+	auto it = index.keys.find(key);
+	if (it == index.keys.end())
+		return;
+	for (uint32_t i = it->second.first; i < it->second.first + it->second.second; i++) {
+		if (spellsText(text, index.forms[i]))
+			emit(index.forms[i]);
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Longest form that fits in a form_t. Forms the data generates past this are
+// left out of the lexicon, and reportLongForms (Main.cpp) names their lemmas.
+#ifndef LEMMA_FORM_CAPACITY
+#define LEMMA_FORM_CAPACITY 47
+#endif
+
+/*
+ * A series held inline in a fixed buffer, so that building a form never
+ * touches the heap. decline/conjugate and the candidate generator produce
+ * these instead of series_t; stored lemma data stays series_t. Appending
+ * past the capacity keeps what fits and sets truncated; a truncated form is
+ * not the form asked for, and the lexicon leaves it out with a diagnostic.
+ */
+struct InlineSeries
+{
+	static const size_t CAPACITY = LEMMA_FORM_CAPACITY;
+
+	uint8_t length = 0;
+	bool truncated = false;
+	char buffer[CAPACITY];
+
+	InlineSeries() = default;
+
+	InlineSeries(const std::string_view &s)
+	{
+		append(s);
+	}
+
+	InlineSeries(const std::string &s) : InlineSeries(std::string_view(s))
+	{}
+
+	InlineSeries(const char *s) : InlineSeries(std::string_view(s))
+	{}
+
+	const size_t size() const
+	{
+		return length;
+	}
+
+	const bool empty() const
+	{
+		return length == 0;
+	}
+
+	const char *data() const
+	{
+		return buffer;
+	}
+
+	const char *begin() const
+	{
+		return buffer;
+	}
+
+	const char *end() const
+	{
+		return buffer + length;
+	}
+
+	const char &operator[](const size_t &i) const
+	{
+		return buffer[i];
+	}
+
+	void clear()
+	{
+		length = 0;
+		truncated = false;
+	}
+
+	void push_back(const char &c)
+	{
+		if (length < CAPACITY)
+			buffer[length++] = c;
+		else
+			truncated = true;
+	}
+
+	void append(const std::string_view &s)
+	{
+		truncated = truncated || length + s.size() > CAPACITY;
+		size_t n = std::min(s.size(), CAPACITY - length);
+		std::memcpy(buffer + length, s.data(), n);
+		length += n;
+	}
+
+	InlineSeries &operator+=(const std::string_view &s)
+	{
+		append(s);
+		return *this;
+	}
+
+	InlineSeries &operator+=(const char &c)
+	{
+		push_back(c);
+		return *this;
+	}
+
+	operator std::string_view() const
+	{
+		return std::string_view(buffer, length);
+	}
+
+	const std::string str() const
+	{
+		return std::string(buffer, length);
+	}
+
+	friend const bool operator==(const InlineSeries &a, const std::string_view &b)
+	{
+		return std::string_view(a) == b;
+	}
+
+	friend const bool operator!=(const InlineSeries &a, const std::string_view &b)
+	{
+		return !(a == b);
+	}
+
+	friend const bool operator==(const InlineSeries &a, const char *b)
+	{
+		return std::string_view(a) == b;
+	}
+
+	friend const bool operator!=(const InlineSeries &a, const char *b)
+	{
+		return !(a == b);
+	}
+};
+
+typedef InlineSeries form_t;
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "Lexicon.h"
+#include "Tag.h"
+
+/*
+ * Frequency weights read from a side file of tab separated lines, headwords
+ * written as in the data files:
+ *
+ *	<headword>	<count>			weight of every analysis of the lemma
+ *	<headword>	<tag>	<count>		weight of one analysis (see tagName)
+ *
+ * A (lemma, tag) weight takes precedence over the lemma's. Counts are stored
+ * in Node::weight on a log scale, which keeps their order in 16 bits.
+ */
+struct Frequencies
+{
+	std::unordered_map<lemma_id_t, double> lemmas;
+	std::unordered_map<uint64_t, double> analyses;
+};
+
+inline const uint16_t quantizeWeight(const double &count)
+{
+	if (count <= 0)
+		return 0;
+	return (uint16_t)std::min(65535.0, std::round(std::log2(1 + count) * 2048));
+}
+
+// Adds the counts of filename to *freq; false, having said so, when the file
+// cannot be opened.
+inline const bool readFrequencies(const Lexicon &lexicon, const std::string &filename, Frequencies *freq)
+{
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		std::cerr << "Cannot open " << filename << "\n";
+		return false;
+	}
+	std::string line;
+	size_t number = 0;
+	while (std::getline(file, line)) {
+		number++;
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		auto contents = parseTabbedLine(line);
+		if (contents.size() < 2)
+			continue;
+		auto it = lexicon.headwords.find(contents[0]);
+		if (it == lexicon.headwords.end()) {
+			std::cerr << "Unknown headword " << contents[0] << " in " << filename << "\n";
+			continue;
+		}
+		double count = -1;
+		size_t used = 0;
+		try {
+			count = std::stod(contents.back(), &used);
+		} catch (const std::exception &) {
+		}
+		if (used != contents.back().size() || !std::isfinite(count) || count < 0) {
+			std::cerr << "Bad count " << contents.back() << " in " << filename << " line " << number << "\n";
+			continue;
+		}
+		tag_t t = 0;
+		if (contents.size() >= 3 && !parseTag(contents[1], &t)) {
+			std::cerr << "Unknown features " << contents[1] << " in " << filename << "\n";
+			continue;
+		}
+		for (auto &id : it->second) {
+			if (contents.size() >= 3)
+				freq->analyses[nodeKey(Node(id, t))] += count;
+			else
+				freq->lemmas[id] += count;
+		}
+	}
+	file.close();
+	return true;
+}
+
+inline void applyFrequencies(SearchMap *map, const Frequencies &freq)
+{
+	for (auto &n : map->lemmas) {
+		auto a = freq.analyses.find(nodeKey(n));
+		if (a != freq.analyses.end()) {
+			n.weight = quantizeWeight(a->second);
+			continue;
+		}
+		auto l = freq.lemmas.find(n.lemma);
+		n.weight = l != freq.lemmas.end() ? quantizeWeight(l->second) : 0;
+	}
+	for (auto &c : map->next)
+		applyFrequencies(&c, freq);
+}
+
+// Lemma weights go in the stem nodes, analysis weights of derived lemmas in
+// the index's weight table.
+inline void applyFrequencies(DerivedIndex *index, SearchMap *map, const Frequencies &freq)
+{
+	for (auto &n : map->lemmas) {
+		auto l = freq.lemmas.find(n.lemma);
+		n.weight = l != freq.lemmas.end() ? quantizeWeight(l->second) : 0;
+		for (auto &e : index->tables[n.tag].endings) {
+			auto key = nodeKey(Node(n.lemma, e.second));
+			auto a = freq.analyses.find(key);
+			if (a != freq.analyses.end())
+				index->weights[key] = quantizeWeight(a->second);
+		}
+	}
+	for (auto &c : map->next)
+		applyFrequencies(index, &c, freq);
+}
+
+inline void applyFrequencies(DerivedIndex *index, const Frequencies &freq)
+{
+	index->weights.clear();
+	applyFrequencies(index, &index->stems, freq);
+}
+
+// Keeps the n heaviest analyses, heaviest first, by partial selection; ties
+// keep their original order. n == 0 keeps everything as is.
+inline void selectTop(std::vector<Analysis> *analyses, const size_t &n)
+{
+	if (n == 0)
+		return;
+	size_t k = std::min(n, analyses->size());
+	std::vector<uint32_t> order(analyses->size());
+	for (uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::partial_sort(order.begin(), order.begin() + k, order.end(), [&](const uint32_t &a, const uint32_t &b) {
+		auto wa = (*analyses)[a].node.weight;
+		auto wb = (*analyses)[b].node.weight;
+		return wa != wb ? wa > wb : a < b;
+	});
+	std::vector<Analysis> top;
+	top.reserve(k);
+	for (size_t i = 0; i < k; i++)
+		top.push_back((*analyses)[order[i]]);
+	analyses->swap(top);
+}
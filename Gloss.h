@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Glosses are not kept in memory. A Gloss names a byte range of one of the
+ * lexicon's data files, which are memory-mapped the first time one of their
+ * glosses is read, so runs that never print a gloss never page them in.
+ * Glosses of synthesized lemmas ("Comparative of ...") are not stored at all:
+ * they are a Derivation of another lemma and are spelled out on demand.
+ */
+const uint8_t GLOSS_NONE = 0;
+const uint8_t GLOSS_DERIVED = 0xFF;
+
+enum Derivation
+{
+	D_COMPARATIVE,
+	D_SUPERLATIVE,
+	D_PERFECT_PASSIVE,
+	D_GERUNDIVE,
+	D_PRESENT_ACTIVE,
+	D_FUTURE_ACTIVE
+};
+
+// For file glosses, offset and length are a byte range of source; for
+// derived ones, offset is the base lemma and length the Derivation.
+struct Gloss
+{
+	uint32_t offset = 0;
+	uint32_t length = 0;
+	uint8_t source = GLOSS_NONE;
+};
+
+inline const bool operator==(const Gloss &a, const Gloss &b)
+{
+	return a.source == b.source && a.offset == b.offset && a.length == b.length;
+}
+
+inline const bool operator!=(const Gloss &a, const Gloss &b)
+{
+	return !(a == b);
+}
+
+inline const Gloss derivedGloss(const uint32_t &lemma, const Derivation &d)
+{
+	return { lemma, (uint32_t)d, GLOSS_DERIVED };
+}
+
+struct MappedFile
+{
+	std::string path;
+	mutable std::once_flag once;
+	mutable const char *data = NULL;
+	mutable size_t size = 0;
+#ifdef _WIN32
+	mutable std::string buffer;
+#endif
+
+	~MappedFile()
+	{
+#ifndef _WIN32
+		if (data != NULL)
+			munmap((void *)data, size);
+#endif
+	}
+};
+
+struct GlossPool
+{
+	std::deque<MappedFile> files;
+};
+
+inline const uint8_t addGlossSource(GlossPool *pool, const std::string &path)
+{
+	pool->files.emplace_back();
+	pool->files.back().path = path;
+	return pool->files.size();
+}
+
+inline void mapFile(const MappedFile &f)
+{
+#ifdef _WIN32
+	std::ifstream file(f.path, std::ios::binary);
+	f.buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	f.data = f.buffer.data();
+	f.size = f.buffer.size();
+#else
+	int fd = open(f.path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			f.data = (const char *)p;
+			f.size = st.st_size;
+		}
+	}
+	close(fd);
+#endif
+}
+
+// Text of a file gloss; empty for derived glosses and unreadable sources.
+inline const std::string_view glossView(const GlossPool &pool, const Gloss &g)
+{
+	if (g.source == GLOSS_NONE || g.source == GLOSS_DERIVED || g.source > pool.files.size())
+		return {};
+	auto &f = pool.files[g.source - 1];
+	std::call_once(f.once, mapFile, std::cref(f));
+	if (f.data == NULL || (size_t)g.offset + g.length > f.size)
+		return {};
+	return std::string_view(f.data + g.offset, g.length);
+}
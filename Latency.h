@@ -0,0 +1,407 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Per-token lookup latency (--latency and friends). Every analyzing thread
+ * records into its own grid of histograms, one per token length band and
+ * candidate count band; readers sum the grids of all threads.
+ *
+ * Histograms are log-linear in the manner of HDR histograms: values below
+ * 2^LATENCY_SUB_BITS nanoseconds get a bucket each, every power of two above
+ * is split into 2^LATENCY_SUB_BITS buckets, so a bucket is never wider than
+ * 1/16 of its values and a quantile is reported within about 6%. Counters
+ * have a single writer and are atomics only so that the metrics endpoint may
+ * read them while a run is going on.
+ */
+
+const int LATENCY_SUB_BITS = 4;
+const size_t LATENCY_SUB = (size_t)1 << LATENCY_SUB_BITS;
+const size_t LATENCY_BUCKETS = (64 - LATENCY_SUB_BITS + 1) * LATENCY_SUB;
+
+inline const size_t latencyBucket(const uint64_t &v)
+{
+	if (v < LATENCY_SUB)
+		return v;
+#if defined(__GNUC__)
+	int e = 63 - __builtin_clzll(v);
+#else
+	int e = 0;
+	while (v >> (e + 1))
+		e++;
+#endif
+	return (e - LATENCY_SUB_BITS + 1) * LATENCY_SUB + ((v >> (e - LATENCY_SUB_BITS)) & (LATENCY_SUB - 1));
+}
+
+// Largest value falling into bucket i.
+inline const uint64_t latencyBucketTop(const size_t &i)
+{
+	if (i < LATENCY_SUB)
+		return i;
+	int e = i / LATENCY_SUB + LATENCY_SUB_BITS - 1;
+	uint64_t low = (LATENCY_SUB + i % LATENCY_SUB) << (e - LATENCY_SUB_BITS);
+	return low + ((uint64_t)1 << (e - LATENCY_SUB_BITS)) - 1;
+}
+
+struct LatencyHistogram
+{
+	std::atomic<uint64_t> counts[LATENCY_BUCKETS] = {};
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<uint64_t> sum{ 0 };
+	std::atomic<uint64_t> max{ 0 };
+};
+
+// A plain copy of one or more histograms summed up.
+struct LatencySnapshot
+{
+	std::vector<uint64_t> counts = std::vector<uint64_t>(LATENCY_BUCKETS, 0);
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t max = 0;
+};
+
+inline void recordLatency(LatencyHistogram *h, const uint64_t &ns)
+{
+	auto bump = [](std::atomic<uint64_t> &a, const uint64_t &by) {
+		a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+	};
+	bump(h->counts[latencyBucket(ns)], 1);
+	bump(h->count, 1);
+	bump(h->sum, ns);
+	if (ns > h->max.load(std::memory_order_relaxed))
+		h->max.store(ns, std::memory_order_relaxed);
+}
+
+inline void addSnapshot(LatencySnapshot *s, const LatencyHistogram &h)
+{
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+		s->counts[i] += h.counts[i].load(std::memory_order_relaxed);
+	s->count += h.count.load(std::memory_order_relaxed);
+	s->sum += h.sum.load(std::memory_order_relaxed);
+	s->max = std::max(s->max, h.max.load(std::memory_order_relaxed));
+}
+
+// In nanoseconds; q in [0, 1].
+inline const uint64_t latencyQuantile(const LatencySnapshot &s, const double &q)
+{
+	if (s.count == 0)
+		return 0;
+	uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q * s.count + 0.5));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+		seen += s.counts[i];
+		if (seen >= rank)
+			return std::min(latencyBucketTop(i), s.max);
+	}
+	return s.max;
+}
+
+// Bands of token length in letters and of candidate spellings looked up.
+const size_t LENGTH_BANDS = 6;
+const size_t CANDIDATE_BANDS = 6;
+const char *const LENGTH_BAND_NAMES[LENGTH_BANDS] = { "1-3", "4-6", "7-9", "10-12", "13-15", "16+" };
+const char *const CANDIDATE_BAND_NAMES[CANDIDATE_BANDS] = { "0", "1", "2", "3-4", "5-8", "9+" };
+
+inline const size_t lengthBand(const size_t &letters)
+{
+	return letters == 0 ? 0 : std::min<size_t>((letters - 1) / 3, LENGTH_BANDS - 1);
+}
+
+inline const size_t candidateBand(const size_t &n)
+{
+	return n <= 2 ? n : n <= 4 ? 3 : n <= 8 ? 4 : 5;
+}
+
+struct TokenLatency
+{
+	LatencyHistogram bands[LENGTH_BANDS][CANDIDATE_BANDS];
+};
+
+// Letters of UTF-8 text: bytes other than continuation bytes.
+inline const size_t letterCount(const std::string_view &s)
+{
+	size_t n = 0;
+	for (auto &c : s)
+		n += ((unsigned char)c & 0xC0) != 0x80;
+	return n;
+}
+
+// Times the rest of the enclosing block as the lookup of token; set
+// candidates before the block ends. Records nothing without a grid.
+struct LatencyTimer
+{
+	TokenLatency *latency;
+	size_t letters = 0;
+	size_t candidates = 0;
+	std::chrono::steady_clock::time_point start;
+
+	LatencyTimer(TokenLatency *latency, const std::string_view &token) : latency(latency)
+	{
+		if (latency != NULL) {
+			letters = letterCount(token);
+			start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~LatencyTimer()
+	{
+		if (latency == NULL)
+			return;
+		uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		recordLatency(&latency->bands[lengthBand(letters)][candidateBand(candidates)], ns);
+	}
+};
+
+// The grids of all threads of a run.
+struct LatencyRegistry
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<TokenLatency>> grids;
+
+	TokenLatency *add()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		grids.push_back(std::make_unique<TokenLatency>());
+		return grids.back().get();
+	}
+};
+
+// Sums band (l, c) over all threads; l == LENGTH_BANDS or c == CANDIDATE_BANDS
+// sums over all bands of that kind.
+inline const LatencySnapshot latencySnapshot(LatencyRegistry &registry, const size_t &l, const size_t &c)
+{
+	LatencySnapshot s;
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (auto &g : registry.grids) {
+		for (size_t i = 0; i < LENGTH_BANDS; i++) {
+			for (size_t j = 0; j < CANDIDATE_BANDS; j++) {
+				if ((l == LENGTH_BANDS || l == i) && (c == CANDIDATE_BANDS || c == j))
+					addSnapshot(&s, g->bands[i][j]);
+			}
+		}
+	}
+	return s;
+}
+
+struct LatencyQuantile
+{
+	const char *name;
+	double q;
+};
+
+const LatencyQuantile LATENCY_QUANTILES[] = { { "p50", 0.5 }, { "p90", 0.9 }, { "p99", 0.99 }, { "p999", 0.999 } };
+
+// Quantiles per band, in microseconds; empty bands are left out.
+inline void printLatency(LatencyRegistry &registry, std::ostream &out)
+{
+	out << "length\tcandidates\ttokens\tp50\tp90\tp99\tp999\tmax (us)\n";
+	auto row = [&](const std::string &length, const std::string &candidates, const LatencySnapshot &s) {
+		out << length << "\t" << candidates << "\t" << s.count << std::fixed << std::setprecision(2);
+		for (auto &q : LATENCY_QUANTILES)
+			out << "\t" << latencyQuantile(s, q.q) / 1000.0;
+		out << "\t" << s.max / 1000.0 << "\n";
+	};
+	for (size_t l = 0; l < LENGTH_BANDS; l++) {
+		for (size_t c = 0; c < CANDIDATE_BANDS; c++) {
+			auto s = latencySnapshot(registry, l, c);
+			if (s.count != 0)
+				row(LENGTH_BAND_NAMES[l], CANDIDATE_BAND_NAMES[c], s);
+		}
+	}
+	row("all", "all", latencySnapshot(registry, LENGTH_BANDS, CANDIDATE_BANDS));
+}
+
+// Prometheus text exposition: a summary per band plus its maximum, all in
+// seconds.
+inline const std::string latencyMetrics(LatencyRegistry &registry)
+{
+	std::ostringstream out;
+	out << std::setprecision(9);
+	out << "# HELP lemma_token_latency_seconds Time to look up one token.\n";
+	out << "# TYPE lemma_token_latency_seconds summary\n";
+	std::vector<std::pair<std::string, LatencySnapshot>> bands;
+	for (size_t l = 0; l < LENGTH_BANDS; l++) {
+		for (size_t c = 0; c < CANDIDATE_BANDS; c++) {
+			auto s = latencySnapshot(registry, l, c);
+			if (s.count != 0)
+				bands.push_back({ std::string("length=\"") + LENGTH_BAND_NAMES[l] + "\",candidates=\"" + CANDIDATE_BAND_NAMES[c] + "\"", std::move(s) });
+		}
+	}
+	for (auto &b : bands) {
+		for (auto &q : LATENCY_QUANTILES)
+			out << "lemma_token_latency_seconds{" << b.first << ",quantile=\"" << q.q << "\"} " << latencyQuantile(b.second, q.q) / 1e9 << "\n";
+		out << "lemma_token_latency_seconds_sum{" << b.first << "} " << b.second.sum / 1e9 << "\n";
+		out << "lemma_token_latency_seconds_count{" << b.first << "} " << b.second.count << "\n";
+	}
+	out << "# HELP lemma_token_latency_max_seconds Slowest token lookup.\n";
+	out << "# TYPE lemma_token_latency_max_seconds gauge\n";
+	for (auto &b : bands)
+		out << "lemma_token_latency_max_seconds{" << b.first << "} " << b.second.max / 1e9 << "\n";
+	return out.str();
+}
+
+struct LatencyObjective
+{
+	std::string name;
+	// quantile, or a negative number for the maximum
+	double q;
+	// microseconds
+	double limit;
+};
+
+/*
+ * Parses objectives such as "p99=20,max=500" (microseconds, over all tokens)
+ * into *objectives; returns false, with the objective at fault reported, when
+ * one is malformed.
+ */
+inline const bool parseLatencySlo(const std::string &spec, std::vector<LatencyObjective> *objectives, std::ostream &err)
+{
+	std::stringstream in(spec);
+	std::string objective;
+	while (std::getline(in, objective, ',')) {
+		auto eq = objective.find('=');
+		LatencyObjective o = { objective.substr(0, eq), -1, 0 };
+		bool known = o.name == "max";
+		for (auto &q : LATENCY_QUANTILES) {
+			if (o.name == q.name) {
+				o.q = q.q;
+				known = true;
+			}
+		}
+		size_t used = 0;
+		try {
+			if (eq != std::string::npos)
+				o.limit = std::stod(objective.substr(eq + 1), &used);
+		} catch (const std::exception &) {
+			used = 0;
+		}
+		if (!known || eq == std::string::npos || used == 0 || used != objective.size() - eq - 1 || o.limit < 0) {
+			err << "Bad latency objective " << objective << " (expected p50, p90, p99, p999 or max = microseconds)\n";
+			return false;
+		}
+		objectives->push_back(o);
+	}
+	if (objectives->empty()) {
+		err << "No latency objectives in " << spec << "\n";
+		return false;
+	}
+	return true;
+}
+
+// Returns false, with one line per objective missed, when any is.
+inline const bool checkLatencySlo(LatencyRegistry &registry, const std::vector<LatencyObjective> &objectives, std::ostream &err)
+{
+	auto s = latencySnapshot(registry, LENGTH_BANDS, CANDIDATE_BANDS);
+	bool met = true;
+	for (auto &o : objectives) {
+		uint64_t actual = o.q < 0 ? s.max : latencyQuantile(s, o.q);
+		if (actual / 1000.0 > o.limit) {
+			err << "Latency " << o.name << " of " << actual / 1000.0 << " us exceeds the objective of " << o.limit << " us\n";
+			met = false;
+		}
+	}
+	return met;
+}
+
+/*
+ * Serves latencyMetrics to any request on 127.0.0.1:port until stopped.
+ * POSIX only; start fails elsewhere.
+ */
+struct MetricsEndpoint
+{
+	LatencyRegistry &registry;
+	std::atomic<bool> stopping{ false };
+	std::thread server;
+	int listener = -1;
+
+	MetricsEndpoint(LatencyRegistry &registry) : registry(registry)
+	{}
+
+	~MetricsEndpoint()
+	{
+		stop();
+	}
+
+	const bool start(const uint16_t &port)
+	{
+#ifdef _WIN32
+		return false;
+#else
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		if (listener < 0)
+			return false;
+		int yes = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+		if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 8) != 0) {
+			close(listener);
+			listener = -1;
+			return false;
+		}
+		server = std::thread([this] { serve(); });
+		return true;
+#endif
+	}
+
+	void stop()
+	{
+		stopping = true;
+		if (server.joinable())
+			server.join();
+#ifndef _WIN32
+		if (listener >= 0)
+			close(listener);
+#endif
+		listener = -1;
+	}
+
+#ifndef _WIN32
+	void serve()
+	{
+		while (!stopping) {
+			pollfd p = { listener, POLLIN, 0 };
+			if (poll(&p, 1, 100) <= 0)
+				continue;
+			int client = accept(listener, NULL, NULL);
+			if (client < 0)
+				continue;
+			// the request itself does not matter
+			char request[1024];
+			pollfd c = { client, POLLIN, 0 };
+			if (poll(&c, 1, 1000) > 0)
+				(void)!recv(client, request, sizeof(request), 0);
+			auto body = latencyMetrics(registry);
+			auto response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+			for (size_t sent = 0; sent < response.size();) {
+				auto n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+				if (n <= 0)
+					break;
+				sent += n;
+			}
+			close(client);
+		}
+	}
+#endif
+};
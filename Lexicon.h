@@ -0,0 +1,226 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+#include "Search.h"
+#include "Form.h"
+#include "Dense.h"
+#include "Derived.h"
+#include "Bloom.h"
+#include "Packed.h"
+#include "Folded.h"
+
+const size_t NOUN_SLOTS = 14;
+const size_t ADJ_SLOTS = 42;
+const size_t VERB_SLOTS = 104;
+
+struct LemmaRef
+{
+	NodeType type;
+	uint32_t index;
+};
+
+struct Lexicon
+{
+	SearchMap search_map;
+	AnalysisTable analyses;
+	DenseTrie dense;
+	DerivedIndex derived;
+	BloomFilter bloom;
+	FoldedIndex folded;
+	std::vector<LemmaRef> refs;
+	std::vector<NounLemma> nouns;
+	std::vector<AdjLemma> adjs;
+	std::vector<VerbLemma> verbs;
+	std::unordered_map<series_t, std::vector<lemma_id_t>> headwords;
+	GlossPool glosses;
+	// with shards set, only forms whose folded spelling falls to shard are
+	// kept (see Shard.h); shard == shards keeps none
+	uint32_t shard = 0;
+	uint32_t shards = 0;
+};
+
+// Every form of every lemma laid out back to back in one pool; a form is
+// found by a lemma's first slot plus the slot of the requested inflection.
+// Missing forms are stored as "*", as decline/conjugate return them.
+struct FormTable
+{
+	std::string pool;
+	std::vector<uint32_t> base;
+	std::vector<uint32_t> offsets;
+};
+
+// The fields of a data file line, a run of tabs counting as one separator.
+inline const std::vector<std::string> parseTabbedLine(const std::string &line)
+{
+	std::vector<std::string> contents = { "" };
+
+	for (auto &c : line) {
+		if (c == '\t') {
+			if (contents.back() == "")
+				continue;
+			contents.push_back("");
+		} else {
+			contents.back().push_back(c);
+		}
+	}
+	return contents;
+}
+
+inline const series_t headword(const NounLemma &nl)
+{
+	return nl.lemma;
+}
+
+inline const series_t headword(const AdjLemma &al)
+{
+	return al.mlemma;
+}
+
+inline const series_t headword(const VerbLemma &vl)
+{
+	for (auto &c : { IND_ACT_SIM_PRE_1SG, IND_PAS_SIM_PRE_1SG, IND_ACT_PRF_PRE_1SG }) {
+		auto d = conjugate(vl, c);
+		if (d != "*")
+			return series_t(d);
+	}
+	return "*";
+}
+
+inline const lemma_id_t addLemma(Lexicon *lexicon, const NounLemma &nl)
+{
+	lemma_id_t id = lexicon->refs.size();
+	lexicon->refs.push_back({ NOUN, (uint32_t)lexicon->nouns.size() });
+	lexicon->nouns.push_back(nl);
+	lexicon->headwords[headword(nl)].push_back(id);
+	return id;
+}
+
+inline const lemma_id_t addLemma(Lexicon *lexicon, const AdjLemma &al)
+{
+	lemma_id_t id = lexicon->refs.size();
+	lexicon->refs.push_back({ ADJECTIVE, (uint32_t)lexicon->adjs.size() });
+	lexicon->adjs.push_back(al);
+	lexicon->headwords[headword(al)].push_back(id);
+	return id;
+}
+
+inline const lemma_id_t addLemma(Lexicon *lexicon, const VerbLemma &vl)
+{
+	lemma_id_t id = lexicon->refs.size();
+	lexicon->refs.push_back({ VERB, (uint32_t)lexicon->verbs.size() });
+	lexicon->verbs.push_back(vl);
+	lexicon->headwords[headword(vl)].push_back(id);
+	return id;
+}
+
+// The gender featureBits takes: the lemma's for nouns, the tag's otherwise.
+inline const Gender analysisGender(const Lexicon &lexicon, const Node &n)
+{
+	if (tagType(n.tag) == NOUN)
+		return lexicon.nouns[lexicon.refs[n.lemma].index].gender;
+	return tagGender(n.tag);
+}
+
+inline const std::vector<lemma_id_t> findHeadword(const Lexicon &lexicon, const series_t &s)
+{
+	auto it = lexicon.headwords.find(s);
+	if (it == lexicon.headwords.end())
+		return {};
+	return it->second;
+}
+
+inline const size_t slotCount(const NodeType &type)
+{
+	switch (type) {
+		case NOUN:
+			return NOUN_SLOTS;
+		case ADJECTIVE:
+			return ADJ_SLOTS;
+		case VERB:
+			return VERB_SLOTS;
+	}
+	return 0;
+}
+
+inline const size_t adjSlot(const Inflection &i, const Gender &g)
+{
+	return (size_t)g * NOUN_SLOTS + (size_t)i;
+}
+
+// Forms too long for a form_t are missing, as they are from the trie.
+inline const form_t slotForm(const Lexicon &lexicon, const lemma_id_t &id, const size_t &slot)
+{
+	auto &ref = lexicon.refs[id];
+	form_t d = "*";
+	switch (ref.type) {
+		case NOUN:
+			d = decline(lexicon.nouns[ref.index], (Inflection)slot);
+			break;
+		case ADJECTIVE:
+			d = decline(lexicon.adjs[ref.index], (Inflection)(slot % NOUN_SLOTS), (Gender)(slot / NOUN_SLOTS));
+			break;
+		case VERB:
+			d = conjugate(lexicon.verbs[ref.index], (ConjugationSchema)slot);
+			break;
+	}
+	return d.truncated ? "*" : d;
+}
+
+inline const FormTable buildFormTable(const Lexicon &lexicon)
+{
+	FormTable table;
+	table.base.reserve(lexicon.refs.size() + 1);
+	for (lemma_id_t id = 0; id < lexicon.refs.size(); id++) {
+		table.base.push_back(table.offsets.size());
+		size_t slots = slotCount(lexicon.refs[id].type);
+		for (size_t slot = 0; slot < slots; slot++) {
+			table.offsets.push_back(table.pool.size());
+			table.pool += slotForm(lexicon, id, slot);
+		}
+	}
+	table.base.push_back(table.offsets.size());
+	table.offsets.push_back(table.pool.size());
+	return table;
+}
+
+inline const std::string_view generateSlot(const FormTable &table, const lemma_id_t &id, const size_t &slot)
+{
+	if (id + 1 >= table.base.size())
+		return "*";
+	size_t i = table.base[id] + slot;
+	if (i >= table.base[id + 1])
+		return "*";
+	return std::string_view(table.pool).substr(table.offsets[i], table.offsets[i + 1] - table.offsets[i]);
+}
+
+inline const std::string_view generate(const FormTable &table, const lemma_id_t &id, const Inflection &i)
+{
+	return generateSlot(table, id, i);
+}
+
+inline const std::string_view generate(const FormTable &table, const lemma_id_t &id, const Inflection &i, const Gender &g)
+{
+	return generateSlot(table, id, adjSlot(i, g));
+}
+
+inline const std::string_view generate(const FormTable &table, const lemma_id_t &id, const ConjugationSchema &c)
+{
+	return generateSlot(table, id, c);
+}
+
+// All slots of a lemma in slot order: Inflection for nouns, Gender * 14 +
+// Inflection for adjectives, ConjugationSchema for verbs.
+inline const std::vector<std::string_view> paradigmTable(const FormTable &table, const lemma_id_t &id)
+{
+	std::vector<std::string_view> forms;
+	if (id + 1 >= table.base.size())
+		return forms;
+	for (size_t i = table.base[id]; i < table.base[id + 1]; i++)
+		forms.push_back(std::string_view(table.pool).substr(table.offsets[i], table.offsets[i + 1] - table.offsets[i]));
+	return forms;
+}
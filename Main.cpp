@@ -6,23 +6,42 @@
 #include <unordered_map>
 #include <map>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <memory>
 
 #include "Search.h"
+#include "Lexicon.h"
+#include "Tag.h"
+#include "Dense.h"
+#include "Frequency.h"
+#include "Fold.h"
+#include "Bloom.h"
+#include "Tokenizer.h"
+#include "Memory.h"
+#include "Trace.h"
+#include "Agreement.h"
+#include "Pipeline.h"
+#include "Suffix.h"
+#include "Latency.h"
+#include "Shard.h"
 
 #ifdef _WIN32
 #include <Windows.h>
 #endif
 
-#define colorASCII(c) "\033[" + std::to_string(c) + "m"
-#define CTEXT(s, c) colorASCII(c) << s << colorASCII(0)
-
-Node::Node(const NounLemma &nl, const NounQuery &nq) : type(NOUN), nounQuery(nq), nounLemma(nl)
-{}
+bool COLOR = true;
+bool GLOSS = false;
 
-Node::Node(const AdjLemma &al, const AdjQuery &aq) : type(ADJECTIVE), adjQuery(aq), adjLemma(al)
-{}
+#define colorASCII(c) (COLOR ? "\033[" + std::to_string(c) + "m" : std::string())
+#define CTEXT(s, c) colorASCII(c) << s << colorASCII(0)
 
-Node::Node(const VerbLemma &vl, const VerbQuery &vq) : type(VERB), verbQuery(vq), verbLemma(vl)
+Node::Node(const lemma_id_t &l, const tag_t &t) : tag(t), lemma(l)
 {}
 
 enum TextColor
@@ -82,7 +101,7 @@ const std::string parseGrapheme(const char &g)
 	}
 }
 
-const std::string parseSeries(const series_t &l)
+const std::string parseSeries(const std::string_view &l)
 {
 	if (l == "*")
 		return "*";
@@ -106,7 +125,7 @@ const std::string canonicalForm(const AdjLemma &);
 const std::string canonicalForm(const NounLemma &);
 const std::string canonicalForm(const VerbLemma &);
 
-const series_t getPersonConj1(const CPerson &person)
+const std::string_view getPersonConj1(const CPerson &person)
 {
 	switch (person) {
 		case _2SG:
@@ -123,7 +142,7 @@ const series_t getPersonConj1(const CPerson &person)
 	return "<error>";
 }
 
-const series_t getPersonConj2(const CPerson &person)
+const std::string_view getPersonConj2(const CPerson &person)
 {
 	switch (person) {
 		case _2SG:
@@ -140,7 +159,7 @@ const series_t getPersonConj2(const CPerson &person)
 	return "<error>";
 }
 
-const series_t getPersonConj3(const CPerson &person)
+const std::string_view getPersonConj3(const CPerson &person)
 {
 	switch (person) {
 		case _2SG:
@@ -157,7 +176,7 @@ const series_t getPersonConj3(const CPerson &person)
 	return "<error>";
 }
 
-const series_t getPersonConj4(const CPerson &person, const bool &future)
+const std::string_view getPersonConj4(const CPerson &person, const bool &future)
 {
 	switch (person) {
 		case _2SG:
@@ -171,7 +190,7 @@ const series_t getPersonConj4(const CPerson &person, const bool &future)
 	return "<error>";
 }
 
-const series_t getPersonConj5(const CPerson &person, const bool &future)
+const std::string_view getPersonConj5(const CPerson &person, const bool &future)
 {
 	switch (person) {
 		case _2SG:
@@ -185,486 +204,486 @@ const series_t getPersonConj5(const CPerson &person, const bool &future)
 	return "<error>";
 }
 
-const series_t conjugate(const VerbLemma &vl, const ConjugationSchema &csch)
+const form_t conjugate(const VerbLemma &vl, const ConjugationSchema &csch)
 {
-	series_t ret;
+	std::string_view ret;
 	CPerson person;
 	bool future;
 	bool simple = true;
 	switch (csch) {
 		case INF_ACT_PRE:
-			ret = vl.active_simple.inf;
+			ret = conjugation(vl.active_simple).inf;
 			break;
 		case INF_ACT_PRF:
-			ret = vl.active_perfect.inf;
+			ret = conjugation(vl.active_perfect).inf;
 			simple = false;
 			break;
 		case INF_PAS_PRE:
-			ret = vl.passive_simple.inf;
+			ret = conjugation(vl.passive_simple).inf;
 			break;
 
 		case IMP_ACT_PRE_2SG:
-			ret = vl.active_simple.imp1;
+			ret = conjugation(vl.active_simple).imp1;
 			person = _2SG;
 			future = false;
 			break;
 		case IMP_ACT_PRE_2PL:
-			ret = vl.active_simple.imp2;
+			ret = conjugation(vl.active_simple).imp2;
 			person = _2PL;
 			future = false;
 			break;
 		case IMP_ACT_FUT_2SG:
-			ret = vl.active_simple.imp2;
+			ret = conjugation(vl.active_simple).imp2;
 			person = _2SG;
 			future = true;
 			break;
 		case IMP_ACT_FUT_3SG:
-			ret = vl.active_simple.imp2;
+			ret = conjugation(vl.active_simple).imp2;
 			person = _3SG;
 			future = true;
 			break;
 		case IMP_ACT_FUT_2PL:
-			ret = vl.active_simple.imp2;
+			ret = conjugation(vl.active_simple).imp2;
 			person = _2PL;
 			future = true;
 			break;
 		case IMP_ACT_FUT_3PL:
-			ret = vl.active_simple.imp3;
+			ret = conjugation(vl.active_simple).imp3;
 			person = _3PL;
 			future = true;
 			break;
 
 		case IMP_PAS_PRE_2SG:
-			ret = vl.passive_simple.imp1;
+			ret = conjugation(vl.passive_simple).imp1;
 			person = _2SG;
 			future = false;
 			break;
 		case IMP_PAS_PRE_2PL:
-			ret = vl.passive_simple.imp2;
+			ret = conjugation(vl.passive_simple).imp2;
 			person = _2PL;
 			future = false;
 			break;
 		case IMP_PAS_FUT_2SG:
-			ret = vl.passive_simple.imp2;
+			ret = conjugation(vl.passive_simple).imp2;
 			person = _2SG;
 			future = true;
 			break;
 		case IMP_PAS_FUT_3SG:
-			ret = vl.passive_simple.imp2;
+			ret = conjugation(vl.passive_simple).imp2;
 			person = _3SG;
 			future = true;
 			break;
 		case IMP_PAS_FUT_3PL:
-			ret = vl.passive_simple.imp3;
+			ret = conjugation(vl.passive_simple).imp3;
 			person = _3PL;
 			future = true;
 			break;
 
 		case IND_ACT_SIM_PRE_1SG:
-			ret = vl.active_simple.ind_pres._1sg;
+			ret = conjugation(vl.active_simple).ind_pres._1sg;
 			person = _1SG;
 			break;
 		case IND_ACT_SIM_PRE_2SG:
-			ret = vl.active_simple.ind_pres._2sg;
+			ret = conjugation(vl.active_simple).ind_pres._2sg;
 			person = _2SG;
 			break;
 		case IND_ACT_SIM_PRE_3SG:
-			ret = vl.active_simple.ind_pres._3sg;
+			ret = conjugation(vl.active_simple).ind_pres._3sg;
 			person = _3SG;
 			break;
 		case IND_ACT_SIM_PRE_1PL:
-			ret = vl.active_simple.ind_pres._1pl;
+			ret = conjugation(vl.active_simple).ind_pres._1pl;
 			person = _1PL;
 			break;
 		case IND_ACT_SIM_PRE_2PL:
-			ret = vl.active_simple.ind_pres._2pl;
+			ret = conjugation(vl.active_simple).ind_pres._2pl;
 			person = _2PL;
 			break;
 		case IND_ACT_SIM_PRE_3PL:
-			ret = vl.active_simple.ind_pres._3pl;
+			ret = conjugation(vl.active_simple).ind_pres._3pl;
 			person = _3PL;
 			break;
 
 		case IND_ACT_SIM_IMP_1SG:
-			ret = vl.active_simple.ind_impf._1sg;
+			ret = conjugation(vl.active_simple).ind_impf._1sg;
 			person = _1SG;
 			break;
 		case IND_ACT_SIM_IMP_2SG:
-			ret = vl.active_simple.ind_impf._2sg;
+			ret = conjugation(vl.active_simple).ind_impf._2sg;
 			person = _2SG;
 			break;
 		case IND_ACT_SIM_IMP_3SG:
-			ret = vl.active_simple.ind_impf._3sg;
+			ret = conjugation(vl.active_simple).ind_impf._3sg;
 			person = _3SG;
 			break;
 		case IND_ACT_SIM_IMP_1PL:
-			ret = vl.active_simple.ind_impf._1pl;
+			ret = conjugation(vl.active_simple).ind_impf._1pl;
 			person = _1PL;
 			break;
 		case IND_ACT_SIM_IMP_2PL:
-			ret = vl.active_simple.ind_impf._2pl;
+			ret = conjugation(vl.active_simple).ind_impf._2pl;
 			person = _2PL;
 			break;
 		case IND_ACT_SIM_IMP_3PL:
-			ret = vl.active_simple.ind_impf._3pl;
+			ret = conjugation(vl.active_simple).ind_impf._3pl;
 			person = _3PL;
 			break;
 
 		case IND_ACT_SIM_FUT_1SG:
-			ret = vl.active_simple.ind_fut._1sg;
+			ret = conjugation(vl.active_simple).ind_fut._1sg;
 			person = _1SG;
 			break;
 		case IND_ACT_SIM_FUT_2SG:
-			ret = vl.active_simple.ind_fut._2sg;
+			ret = conjugation(vl.active_simple).ind_fut._2sg;
 			person = _2SG;
 			break;
 		case IND_ACT_SIM_FUT_3SG:
-			ret = vl.active_simple.ind_fut._3sg;
+			ret = conjugation(vl.active_simple).ind_fut._3sg;
 			person = _3SG;
 			break;
 		case IND_ACT_SIM_FUT_1PL:
-			ret = vl.active_simple.ind_fut._1pl;
+			ret = conjugation(vl.active_simple).ind_fut._1pl;
 			person = _1PL;
 			break;
 		case IND_ACT_SIM_FUT_2PL:
-			ret = vl.active_simple.ind_fut._2pl;
+			ret = conjugation(vl.active_simple).ind_fut._2pl;
 			person = _2PL;
 			break;
 		case IND_ACT_SIM_FUT_3PL:
-			ret = vl.active_simple.ind_fut._3pl;
+			ret = conjugation(vl.active_simple).ind_fut._3pl;
 			person = _3PL;
 			break;
 
 		case IND_ACT_PRF_PRE_1SG:
-			ret = vl.active_perfect.ind_pres._1sg;
+			ret = conjugation(vl.active_perfect).ind_pres._1sg;
 			person = _1SG;
 			simple = false;
 			break;
 		case IND_ACT_PRF_PRE_2SG:
-			ret = vl.active_perfect.ind_pres._2sg;
+			ret = conjugation(vl.active_perfect).ind_pres._2sg;
 			person = _2SG;
 			break;
 		case IND_ACT_PRF_PRE_3SG:
-			ret = vl.active_perfect.ind_pres._3sg;
+			ret = conjugation(vl.active_perfect).ind_pres._3sg;
 			person = _3SG;
 			simple = false;
 			break;
 		case IND_ACT_PRF_PRE_1PL:
-			ret = vl.active_perfect.ind_pres._1pl;
+			ret = conjugation(vl.active_perfect).ind_pres._1pl;
 			person = _1PL;
 			simple = false;
 			break;
 		case IND_ACT_PRF_PRE_2PL:
-			ret = vl.active_perfect.ind_pres._2pl;
+			ret = conjugation(vl.active_perfect).ind_pres._2pl;
 			person = _2PL;
 			simple = false;
 			break;
 		case IND_ACT_PRF_PRE_3PL:
-			ret = vl.active_perfect.ind_pres._3pl;
+			ret = conjugation(vl.active_perfect).ind_pres._3pl;
 			person = _3PL;
 			simple = false;
 			break;
 
 		case IND_ACT_PRF_IMP_1SG:
-			ret = vl.active_perfect.ind_impf._1sg;
+			ret = conjugation(vl.active_perfect).ind_impf._1sg;
 			person = _1SG;
 			simple = false;
 			break;
 		case IND_ACT_PRF_IMP_2SG:
-			ret = vl.active_perfect.ind_impf._2sg;
+			ret = conjugation(vl.active_perfect).ind_impf._2sg;
 			person = _2SG;
 			simple = false;
 			break;
 		case IND_ACT_PRF_IMP_3SG:
-			ret = vl.active_perfect.ind_impf._3sg;
+			ret = conjugation(vl.active_perfect).ind_impf._3sg;
 			person = _3SG;
 			simple = false;
 			break;
 		case IND_ACT_PRF_IMP_1PL:
-			ret = vl.active_perfect.ind_impf._1pl;
+			ret = conjugation(vl.active_perfect).ind_impf._1pl;
 			person = _1PL;
 			simple = false;
 			break;
 		case IND_ACT_PRF_IMP_2PL:
-			ret = vl.active_perfect.ind_impf._2pl;
+			ret = conjugation(vl.active_perfect).ind_impf._2pl;
 			person = _2PL;
 			simple = false;
 			break;
 		case IND_ACT_PRF_IMP_3PL:
-			ret = vl.active_perfect.ind_impf._3pl;
+			ret = conjugation(vl.active_perfect).ind_impf._3pl;
 			person = _3PL;
 			simple = false;
 			break;
 
 		case IND_ACT_PRF_FUT_1SG:
-			ret = vl.active_perfect.ind_fut._1sg;
+			ret = conjugation(vl.active_perfect).ind_fut._1sg;
 			person = _1SG;
 			simple = false;
 			break;
 		case IND_ACT_PRF_FUT_2SG:
-			ret = vl.active_perfect.ind_fut._2sg;
+			ret = conjugation(vl.active_perfect).ind_fut._2sg;
 			person = _2SG;
 			simple = false;
 			break;
 		case IND_ACT_PRF_FUT_3SG:
-			ret = vl.active_perfect.ind_fut._3sg;
+			ret = conjugation(vl.active_perfect).ind_fut._3sg;
 			person = _3SG;
 			simple = false;
 			break;
 		case IND_ACT_PRF_FUT_1PL:
-			ret = vl.active_perfect.ind_fut._1pl;
+			ret = conjugation(vl.active_perfect).ind_fut._1pl;
 			person = _1PL;
 			simple = false;
 			break;
 		case IND_ACT_PRF_FUT_2PL:
-			ret = vl.active_perfect.ind_fut._2pl;
+			ret = conjugation(vl.active_perfect).ind_fut._2pl;
 			person = _2PL;
 			simple = false;
 			break;
 		case IND_ACT_PRF_FUT_3PL:
-			ret = vl.active_perfect.ind_fut._3pl;
+			ret = conjugation(vl.active_perfect).ind_fut._3pl;
 			person = _3PL;
 			simple = false;
 			break;
 
 		case IND_PAS_SIM_PRE_1SG:
-			ret = vl.passive_simple.ind_pres._1sg;
+			ret = conjugation(vl.passive_simple).ind_pres._1sg;
 			person = _1SG;
 			break;
 		case IND_PAS_SIM_PRE_2SG:
-			ret = vl.passive_simple.ind_pres._2sg;
+			ret = conjugation(vl.passive_simple).ind_pres._2sg;
 			person = _2SG;
 			break;
 		case IND_PAS_SIM_PRE_3SG:
-			ret = vl.passive_simple.ind_pres._3sg;
+			ret = conjugation(vl.passive_simple).ind_pres._3sg;
 			person = _3SG;
 			break;
 		case IND_PAS_SIM_PRE_1PL:
-			ret = vl.passive_simple.ind_pres._1pl;
+			ret = conjugation(vl.passive_simple).ind_pres._1pl;
 			person = _1PL;
 			break;
 		case IND_PAS_SIM_PRE_2PL:
-			ret = vl.passive_simple.ind_pres._2pl;
+			ret = conjugation(vl.passive_simple).ind_pres._2pl;
 			person = _2PL;
 			break;
 		case IND_PAS_SIM_PRE_3PL:
-			ret = vl.passive_simple.ind_pres._3pl;
+			ret = conjugation(vl.passive_simple).ind_pres._3pl;
 			person = _3PL;
 			break;
 
 		case IND_PAS_SIM_IMP_1SG:
-			ret = vl.passive_simple.ind_impf._1sg;
+			ret = conjugation(vl.passive_simple).ind_impf._1sg;
 			person = _1SG;
 			break;
 		case IND_PAS_SIM_IMP_2SG:
-			ret = vl.passive_simple.ind_impf._2sg;
+			ret = conjugation(vl.passive_simple).ind_impf._2sg;
 			person = _2SG;
 			break;
 		case IND_PAS_SIM_IMP_3SG:
-			ret = vl.passive_simple.ind_impf._3sg;
+			ret = conjugation(vl.passive_simple).ind_impf._3sg;
 			person = _3SG;
 			break;
 		case IND_PAS_SIM_IMP_1PL:
-			ret = vl.passive_simple.ind_impf._1pl;
+			ret = conjugation(vl.passive_simple).ind_impf._1pl;
 			person = _1PL;
 			break;
 		case IND_PAS_SIM_IMP_2PL:
-			ret = vl.passive_simple.ind_impf._2pl;
+			ret = conjugation(vl.passive_simple).ind_impf._2pl;
 			person = _2PL;
 			break;
 		case IND_PAS_SIM_IMP_3PL:
-			ret = vl.passive_simple.ind_impf._3pl;
+			ret = conjugation(vl.passive_simple).ind_impf._3pl;
 			person = _3PL;
 			break;
 
 		case IND_PAS_SIM_FUT_1SG:
-			ret = vl.passive_simple.ind_fut._1sg;
+			ret = conjugation(vl.passive_simple).ind_fut._1sg;
 			person = _1SG;
 			break;
 		case IND_PAS_SIM_FUT_2SG:
-			ret = vl.passive_simple.ind_fut._2sg;
+			ret = conjugation(vl.passive_simple).ind_fut._2sg;
 			person = _2SG;
 			break;
 		case IND_PAS_SIM_FUT_3SG:
-			ret = vl.passive_simple.ind_fut._3sg;
+			ret = conjugation(vl.passive_simple).ind_fut._3sg;
 			person = _3SG;
 			break;
 		case IND_PAS_SIM_FUT_1PL:
-			ret = vl.passive_simple.ind_fut._1pl;
+			ret = conjugation(vl.passive_simple).ind_fut._1pl;
 			person = _1PL;
 			break;
 		case IND_PAS_SIM_FUT_2PL:
-			ret = vl.passive_simple.ind_fut._2pl;
+			ret = conjugation(vl.passive_simple).ind_fut._2pl;
 			person = _2PL;
 			break;
 		case IND_PAS_SIM_FUT_3PL:
-			ret = vl.passive_simple.ind_fut._3pl;
+			ret = conjugation(vl.passive_simple).ind_fut._3pl;
 			person = _3PL;
 			break;
 
 		case SUB_ACT_SIM_PRE_1SG:
-			ret = vl.active_simple.sub_pres._1sg;
+			ret = conjugation(vl.active_simple).sub_pres._1sg;
 			person = _1SG;
 			break;
 		case SUB_ACT_SIM_PRE_2SG:
-			ret = vl.active_simple.sub_pres._2sg;
+			ret = conjugation(vl.active_simple).sub_pres._2sg;
 			person = _2SG;
 			break;
 		case SUB_ACT_SIM_PRE_3SG:
-			ret = vl.active_simple.sub_pres._3sg;
+			ret = conjugation(vl.active_simple).sub_pres._3sg;
 			person = _3SG;
 			break;
 		case SUB_ACT_SIM_PRE_1PL:
-			ret = vl.active_simple.sub_pres._1pl;
+			ret = conjugation(vl.active_simple).sub_pres._1pl;
 			person = _1PL;
 			break;
 		case SUB_ACT_SIM_PRE_2PL:
-			ret = vl.active_simple.sub_pres._2pl;
+			ret = conjugation(vl.active_simple).sub_pres._2pl;
 			person = _2PL;
 			break;
 		case SUB_ACT_SIM_PRE_3PL:
-			ret = vl.active_simple.sub_pres._3pl;
+			ret = conjugation(vl.active_simple).sub_pres._3pl;
 			person = _3PL;
 			break;
 
 		case SUB_ACT_SIM_IMP_1SG:
-			ret = vl.active_simple.sub_impf._1sg;
+			ret = conjugation(vl.active_simple).sub_impf._1sg;
 			person = _1SG;
 			break;
 		case SUB_ACT_SIM_IMP_2SG:
-			ret = vl.active_simple.sub_impf._2sg;
+			ret = conjugation(vl.active_simple).sub_impf._2sg;
 			person = _2SG;
 			break;
 		case SUB_ACT_SIM_IMP_3SG:
-			ret = vl.active_simple.sub_impf._3sg;
+			ret = conjugation(vl.active_simple).sub_impf._3sg;
 			person = _3SG;
 			break;
 		case SUB_ACT_SIM_IMP_1PL:
-			ret = vl.active_simple.sub_impf._1pl;
+			ret = conjugation(vl.active_simple).sub_impf._1pl;
 			person = _1PL;
 			break;
 		case SUB_ACT_SIM_IMP_2PL:
-			ret = vl.active_simple.sub_impf._2pl;
+			ret = conjugation(vl.active_simple).sub_impf._2pl;
 			person = _2PL;
 			break;
 		case SUB_ACT_SIM_IMP_3PL:
-			ret = vl.active_simple.sub_impf._3pl;
+			ret = conjugation(vl.active_simple).sub_impf._3pl;
 			person = _3PL;
 			break;
 
 		case SUB_ACT_PRF_PRE_1SG:
-			ret = vl.active_perfect.sub_pres._1sg;
+			ret = conjugation(vl.active_perfect).sub_pres._1sg;
 			person = _1SG;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_PRE_2SG:
-			ret = vl.active_perfect.sub_pres._2sg;
+			ret = conjugation(vl.active_perfect).sub_pres._2sg;
 			person = _2SG;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_PRE_3SG:
-			ret = vl.active_perfect.sub_pres._3sg;
+			ret = conjugation(vl.active_perfect).sub_pres._3sg;
 			person = _3SG;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_PRE_1PL:
-			ret = vl.active_perfect.sub_pres._1pl;
+			ret = conjugation(vl.active_perfect).sub_pres._1pl;
 			person = _1PL;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_PRE_2PL:
-			ret = vl.active_perfect.sub_pres._2pl;
+			ret = conjugation(vl.active_perfect).sub_pres._2pl;
 			person = _2PL;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_PRE_3PL:
-			ret = vl.active_perfect.sub_pres._3pl;
+			ret = conjugation(vl.active_perfect).sub_pres._3pl;
 			person = _3PL;
 			simple = false;
 			break;
 
 		case SUB_ACT_PRF_IMP_1SG:
-			ret = vl.active_perfect.sub_impf._1sg;
+			ret = conjugation(vl.active_perfect).sub_impf._1sg;
 			person = _1SG;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_IMP_2SG:
-			ret = vl.active_perfect.sub_impf._2sg;
+			ret = conjugation(vl.active_perfect).sub_impf._2sg;
 			person = _2SG;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_IMP_3SG:
-			ret = vl.active_perfect.sub_impf._3sg;
+			ret = conjugation(vl.active_perfect).sub_impf._3sg;
 			person = _3SG;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_IMP_1PL:
-			ret = vl.active_perfect.sub_impf._1pl;
+			ret = conjugation(vl.active_perfect).sub_impf._1pl;
 			person = _1PL;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_IMP_2PL:
-			ret = vl.active_perfect.sub_impf._2pl;
+			ret = conjugation(vl.active_perfect).sub_impf._2pl;
 			person = _2PL;
 			simple = false;
 			break;
 		case SUB_ACT_PRF_IMP_3PL:
-			ret = vl.active_perfect.sub_impf._3pl;
+			ret = conjugation(vl.active_perfect).sub_impf._3pl;
 			person = _3PL;
 			simple = false;
 			break;
 
 		case SUB_PAS_SIM_PRE_1SG:
-			ret = vl.passive_simple.sub_pres._1sg;
+			ret = conjugation(vl.passive_simple).sub_pres._1sg;
 			person = _1SG;
 			break;
 		case SUB_PAS_SIM_PRE_2SG:
-			ret = vl.passive_simple.sub_pres._2sg;
+			ret = conjugation(vl.passive_simple).sub_pres._2sg;
 			person = _2SG;
 			break;
 		case SUB_PAS_SIM_PRE_3SG:
-			ret = vl.passive_simple.sub_pres._3sg;
+			ret = conjugation(vl.passive_simple).sub_pres._3sg;
 			person = _3SG;
 			break;
 		case SUB_PAS_SIM_PRE_1PL:
-			ret = vl.passive_simple.sub_pres._1pl;
+			ret = conjugation(vl.passive_simple).sub_pres._1pl;
 			person = _1PL;
 			break;
 		case SUB_PAS_SIM_PRE_2PL:
-			ret = vl.passive_simple.sub_pres._2pl;
+			ret = conjugation(vl.passive_simple).sub_pres._2pl;
 			person = _2PL;
 			break;
 		case SUB_PAS_SIM_PRE_3PL:
-			ret = vl.passive_simple.sub_pres._3pl;
+			ret = conjugation(vl.passive_simple).sub_pres._3pl;
 			person = _3PL;
 			break;
 
 		case SUB_PAS_SIM_IMP_1SG:
-			ret = vl.passive_simple.sub_impf._1sg;
+			ret = conjugation(vl.passive_simple).sub_impf._1sg;
 			person = _1SG;
 			break;
 		case SUB_PAS_SIM_IMP_2SG:
-			ret = vl.passive_simple.sub_impf._2sg;
+			ret = conjugation(vl.passive_simple).sub_impf._2sg;
 			person = _2SG;
 			break;
 		case SUB_PAS_SIM_IMP_3SG:
-			ret = vl.passive_simple.sub_impf._3sg;
+			ret = conjugation(vl.passive_simple).sub_impf._3sg;
 			person = _3SG;
 			break;
 		case SUB_PAS_SIM_IMP_1PL:
-			ret = vl.passive_simple.sub_impf._1pl;
+			ret = conjugation(vl.passive_simple).sub_impf._1pl;
 			person = _1PL;
 			break;
 		case SUB_PAS_SIM_IMP_2PL:
-			ret = vl.passive_simple.sub_impf._2pl;
+			ret = conjugation(vl.passive_simple).sub_impf._2pl;
 			person = _2PL;
 			break;
 		case SUB_PAS_SIM_IMP_3PL:
-			ret = vl.passive_simple.sub_impf._3pl;
+			ret = conjugation(vl.passive_simple).sub_impf._3pl;
 			person = _3PL;
 			break;
 	}
-	series_t seq;
+	form_t seq;
 	for (auto &c : ret) {
 		switch (c) {
 			case '!':
@@ -698,54 +717,54 @@ const series_t conjugate(const VerbLemma &vl, const ConjugationSchema &csch)
 	return seq;
 }
 
-const series_t decline(const NounLemma &nl, const Inflection &inflection)
+const form_t decline(const NounLemma &nl, const Inflection &inflection)
 {
-	series_t suffix;
+	std::string_view suffix;
 	switch (inflection) {
 		case NOM_SG:
-			suffix = nl.decl.nom.sg;
+			suffix = declension(nl.decl).nom.sg;
 			break;
 		case NOM_PL:
-			suffix = nl.decl.nom.pl;
+			suffix = declension(nl.decl).nom.pl;
 			break;
 		case GEN_SG:
-			suffix = nl.decl.gen.sg;
+			suffix = declension(nl.decl).gen.sg;
 			break;
 		case GEN_PL:
-			suffix = nl.decl.gen.pl;
+			suffix = declension(nl.decl).gen.pl;
 			break;
 		case DAT_SG:
-			suffix = nl.decl.dat.sg;
+			suffix = declension(nl.decl).dat.sg;
 			break;
 		case DAT_PL:
-			suffix = nl.decl.dat.pl;
+			suffix = declension(nl.decl).dat.pl;
 			break;
 		case ACC_SG:
-			suffix = nl.decl.acc.sg;
+			suffix = declension(nl.decl).acc.sg;
 			break;
 		case ACC_PL:
-			suffix = nl.decl.acc.pl;
+			suffix = declension(nl.decl).acc.pl;
 			break;
 		case ABL_SG:
-			suffix = nl.decl.abl.sg;
+			suffix = declension(nl.decl).abl.sg;
 			break;
 		case ABL_PL:
-			suffix = nl.decl.abl.pl;
+			suffix = declension(nl.decl).abl.pl;
 			break;
 		case VOC_SG:
-			suffix = nl.decl.voc.sg;
+			suffix = declension(nl.decl).voc.sg;
 			break;
 		case VOC_PL:
-			suffix = nl.decl.voc.pl;
+			suffix = declension(nl.decl).voc.pl;
 			break;
 		case LOC_SG:
-			suffix = nl.decl.loc.sg;
+			suffix = declension(nl.decl).loc.sg;
 			break;
 		case LOC_PL:
-			suffix = nl.decl.loc.pl;
+			suffix = declension(nl.decl).loc.pl;
 			break;
 	}
-	series_t ret = "";
+	form_t ret;
 	for (auto &c : suffix) {
 		switch (c) {
 			case '*':
@@ -763,25 +782,26 @@ const series_t decline(const NounLemma &nl, const Inflection &inflection)
 	return ret;
 }
 
-const series_t decline(const AdjLemma &al, const Inflection &inflection, const Gender &g)
+const form_t decline(const AdjLemma &al, const Inflection &inflection, const Gender &g)
 {
-	series_t suffix;
-	series_t lemma;
-	Declension d;
+	form_t suffix;
+	std::string_view lemma;
+	paradigm_id_t id = 0;
 	switch (g) {
 		case G_MAS:
-			d = al.mas;
+			id = al.mas;
 			lemma = al.mlemma;
 			break;
 		case G_FEM:
-			d = al.fem;
+			id = al.fem;
 			lemma = al.flemma;
 			break;
 		case G_NEU:
-			d = al.neu;
+			id = al.neu;
 			lemma = al.nlemma;
 			break;
 	}
+	auto &d = declension(id);
 	switch (inflection) {
 		case NOM_SG:
 			suffix = d.nom.sg;
@@ -828,7 +848,7 @@ const series_t decline(const AdjLemma &al, const Inflection &inflection, const G
 	}
 	if (al.suffix != "*")
 		suffix += al.suffix;
-	series_t ret = "";
+	form_t ret;
 	for (auto &c : suffix) {
 		switch (c) {
 			case '*':
@@ -897,13 +917,129 @@ const std::string genderName(const Gender &gender)
 	}
 }
 
-std::unordered_map<std::string, Declension> DECLS;
-std::unordered_map<std::string, Conjugation> CONJ;
+const std::string conjugationName(const ConjugationSchema &c)
+{
+	static const char *NAMES[] = {
+		"INF_ACT_PRE",
+		"INF_ACT_PRF",
+		"INF_PAS_PRE",
+		"IMP_ACT_PRE_2SG",
+		"IMP_ACT_PRE_2PL",
+		"IMP_ACT_FUT_2SG",
+		"IMP_ACT_FUT_3SG",
+		"IMP_ACT_FUT_2PL",
+		"IMP_ACT_FUT_3PL",
+		"IMP_PAS_PRE_2SG",
+		"IMP_PAS_PRE_2PL",
+		"IMP_PAS_FUT_2SG",
+		"IMP_PAS_FUT_3SG",
+		"IMP_PAS_FUT_3PL",
+		"IND_ACT_SIM_PRE_1SG",
+		"IND_ACT_SIM_PRE_2SG",
+		"IND_ACT_SIM_PRE_3SG",
+		"IND_ACT_SIM_PRE_1PL",
+		"IND_ACT_SIM_PRE_2PL",
+		"IND_ACT_SIM_PRE_3PL",
+		"IND_ACT_SIM_IMP_1SG",
+		"IND_ACT_SIM_IMP_2SG",
+		"IND_ACT_SIM_IMP_3SG",
+		"IND_ACT_SIM_IMP_1PL",
+		"IND_ACT_SIM_IMP_2PL",
+		"IND_ACT_SIM_IMP_3PL",
+		"IND_ACT_SIM_FUT_1SG",
+		"IND_ACT_SIM_FUT_2SG",
+		"IND_ACT_SIM_FUT_3SG",
+		"IND_ACT_SIM_FUT_1PL",
+		"IND_ACT_SIM_FUT_2PL",
+		"IND_ACT_SIM_FUT_3PL",
+		"IND_ACT_PRF_PRE_1SG",
+		"IND_ACT_PRF_PRE_2SG",
+		"IND_ACT_PRF_PRE_3SG",
+		"IND_ACT_PRF_PRE_1PL",
+		"IND_ACT_PRF_PRE_2PL",
+		"IND_ACT_PRF_PRE_3PL",
+		"IND_ACT_PRF_IMP_1SG",
+		"IND_ACT_PRF_IMP_2SG",
+		"IND_ACT_PRF_IMP_3SG",
+		"IND_ACT_PRF_IMP_1PL",
+		"IND_ACT_PRF_IMP_2PL",
+		"IND_ACT_PRF_IMP_3PL",
+		"IND_ACT_PRF_FUT_1SG",
+		"IND_ACT_PRF_FUT_2SG",
+		"IND_ACT_PRF_FUT_3SG",
+		"IND_ACT_PRF_FUT_1PL",
+		"IND_ACT_PRF_FUT_2PL",
+		"IND_ACT_PRF_FUT_3PL",
+		"IND_PAS_SIM_PRE_1SG",
+		"IND_PAS_SIM_PRE_2SG",
+		"IND_PAS_SIM_PRE_3SG",
+		"IND_PAS_SIM_PRE_1PL",
+		"IND_PAS_SIM_PRE_2PL",
+		"IND_PAS_SIM_PRE_3PL",
+		"IND_PAS_SIM_IMP_1SG",
+		"IND_PAS_SIM_IMP_2SG",
+		"IND_PAS_SIM_IMP_3SG",
+		"IND_PAS_SIM_IMP_1PL",
+		"IND_PAS_SIM_IMP_2PL",
+		"IND_PAS_SIM_IMP_3PL",
+		"IND_PAS_SIM_FUT_1SG",
+		"IND_PAS_SIM_FUT_2SG",
+		"IND_PAS_SIM_FUT_3SG",
+		"IND_PAS_SIM_FUT_1PL",
+		"IND_PAS_SIM_FUT_2PL",
+		"IND_PAS_SIM_FUT_3PL",
+		"SUB_ACT_SIM_PRE_1SG",
+		"SUB_ACT_SIM_PRE_2SG",
+		"SUB_ACT_SIM_PRE_3SG",
+		"SUB_ACT_SIM_PRE_1PL",
+		"SUB_ACT_SIM_PRE_2PL",
+		"SUB_ACT_SIM_PRE_3PL",
+		"SUB_ACT_SIM_IMP_1SG",
+		"SUB_ACT_SIM_IMP_2SG",
+		"SUB_ACT_SIM_IMP_3SG",
+		"SUB_ACT_SIM_IMP_1PL",
+		"SUB_ACT_SIM_IMP_2PL",
+		"SUB_ACT_SIM_IMP_3PL",
+		"SUB_ACT_PRF_PRE_1SG",
+		"SUB_ACT_PRF_PRE_2SG",
+		"SUB_ACT_PRF_PRE_3SG",
+		"SUB_ACT_PRF_PRE_1PL",
+		"SUB_ACT_PRF_PRE_2PL",
+		"SUB_ACT_PRF_PRE_3PL",
+		"SUB_ACT_PRF_IMP_1SG",
+		"SUB_ACT_PRF_IMP_2SG",
+		"SUB_ACT_PRF_IMP_3SG",
+		"SUB_ACT_PRF_IMP_1PL",
+		"SUB_ACT_PRF_IMP_2PL",
+		"SUB_ACT_PRF_IMP_3PL",
+		"SUB_PAS_SIM_PRE_1SG",
+		"SUB_PAS_SIM_PRE_2SG",
+		"SUB_PAS_SIM_PRE_3SG",
+		"SUB_PAS_SIM_PRE_1PL",
+		"SUB_PAS_SIM_PRE_2PL",
+		"SUB_PAS_SIM_PRE_3PL",
+		"SUB_PAS_SIM_IMP_1SG",
+		"SUB_PAS_SIM_IMP_2SG",
+		"SUB_PAS_SIM_IMP_3SG",
+		"SUB_PAS_SIM_IMP_1PL",
+		"SUB_PAS_SIM_IMP_2PL",
+		"SUB_PAS_SIM_IMP_3PL"
+	};
+	if ((size_t)c >= sizeof(NAMES) / sizeof(NAMES[0]))
+		return "<error>";
+	return NAMES[c];
+}
+
+std::vector<Declension> DECLENSIONS;
+std::vector<Conjugation> CONJUGATIONS = { Conjugation() };
+std::unordered_map<std::string, paradigm_id_t> DECLS;
+std::unordered_map<std::string, paradigm_id_t> CONJ;
 
-const Declension readDeclension(const std::string &filename)
+const paradigm_id_t readDeclension(const std::string &filename)
 {
 	if (DECLS.find(filename) != DECLS.end())
 		return DECLS[filename];
+	TRACE_SCOPE("readDeclension");
 	std::ifstream file;
 	file.open(std::filesystem::current_path() / "data" / "decl" / filename);
 	if (!file.is_open()) {
@@ -916,7 +1052,8 @@ const Declension readDeclension(const std::string &filename)
 	}
 	file.close();
 
-	DECLS[filename] = {
+	DECLS[filename] = DECLENSIONS.size();
+	DECLENSIONS.push_back({
 		decl[0],
 		decl[1],
 		decl[2],
@@ -932,17 +1069,18 @@ const Declension readDeclension(const std::string &filename)
 		decl[12],
 		decl[13],
 		decl[14]
-	};
+	});
 
 	return DECLS[filename];
 }
 
-const Conjugation readConjugation(const std::string &filename)
+const paradigm_id_t readConjugation(const std::string &filename)
 {
 	if (filename == "*")
-		return Conjugation();
+		return 0;
 	if (CONJ.find(filename) != CONJ.end())
 		return CONJ[filename];
+	TRACE_SCOPE("readConjugation");
 	std::ifstream file;
 	file.open(std::filesystem::current_path() / "data" / "conj" / filename);
 	if (!file.is_open()) {
@@ -957,7 +1095,8 @@ const Conjugation readConjugation(const std::string &filename)
 	}
 	file.close();
 
-	CONJ[filename] = {
+	CONJ[filename] = CONJUGATIONS.size();
+	CONJUGATIONS.push_back({
 		// name
 		conj[0],
 		// inf
@@ -1011,41 +1150,57 @@ const Conjugation readConjugation(const std::string &filename)
 			conj[33],
 			conj[34]
 		}
-	};
+	});
 
 	return CONJ[filename];
 }
 
-const std::vector<std::string> parseTabbedLine(const std::string &line)
+// Whether form is kept in this process's share of the lexicon.
+const bool ownsForm(const Lexicon &lexicon, const std::string_view &form)
 {
-	std::vector<std::string> contents = { "" };
+	if (lexicon.shards == 0)
+		return true;
+	char key[form_t::CAPACITY];
+	if (form.size() > form_t::CAPACITY)
+		return shardOf(foldSeries(form), lexicon.shards) == lexicon.shard;
+	return shardOf(std::string_view(key, foldSeries(form, key)), lexicon.shards) == lexicon.shard;
+}
 
-	for (auto &c : line) {
-		if (c == '\t') {
-			if (contents.back() == "")
-				continue;
-			contents.push_back("");
-		} else {
-			contents.back().push_back(c);
-		}
-	}
-	return contents;
+// A form too long for a form_t comes back truncated; it is left out rather
+// than indexed under the wrong spelling, and each lemma losing forms that
+// way is reported once.
+const bool fitsForm(const form_t &d, size_t *tooLong)
+{
+	*tooLong += d.truncated;
+	return !d.truncated;
+}
+
+template<typename L>
+void reportLongForms(const L &lemma, const size_t &tooLong)
+{
+	if (tooLong != 0)
+		std::cerr << tooLong << " forms of " << parseSeries(headword(lemma)) << " are longer than " << form_t::CAPACITY << " bytes and are left out (raise LEMMA_FORM_CAPACITY)\n";
 }
 
-void registerNounLemma(const NounLemma &lemma, SearchMap *search_map)
+const lemma_id_t registerNounLemma(const NounLemma &lemma, Lexicon *lexicon)
 {
+	TRACE_SCOPE("insert");
+	auto id = addLemma(lexicon, lemma);
+	auto search_map = &lexicon->search_map;
+	size_t tooLong = 0;
 	for (int i = 0; i < 14; i++) {
 		auto current = search_map;
 		auto d = decline(lemma, (Inflection)i);
-		if (d != "*") {
+		if (d != "*" && fitsForm(d, &tooLong) && ownsForm(*lexicon, d)) {
 			for (auto &c : d) {
-				current = &current->next[c];
+				current = addChild(current, c);
 			}
 			Node n(
-				lemma,
-				{ (Inflection)i }
+				id,
+				makeTag(NounQuery{ (Inflection)i })
 			);
 			current->lemmas.push_back(n);
+			current->features |= featureBits(n.tag, lemma.gender);
 		}
 	}
 	/*auto current = search_map;
@@ -1061,23 +1216,30 @@ void registerNounLemma(const NounLemma &lemma, SearchMap *search_map)
 		}
 		current->noun_lemmas.push_back(lemma);
 	}*/
+	reportLongForms(lemma, tooLong);
+	return id;
 }
 
-void registerAdjLemma(const AdjLemma &lemma, SearchMap *search_map)
+const lemma_id_t registerAdjLemma(const AdjLemma &lemma, Lexicon *lexicon)
 {
+	TRACE_SCOPE("insert");
+	auto id = addLemma(lexicon, lemma);
+	auto search_map = &lexicon->search_map;
+	size_t tooLong = 0;
 	for (int j = 0; j < 3; j++) {
 		for (int i = 0; i < 14; i++) {
 			auto current = search_map;
 			auto d = decline(lemma, (Inflection)i, (Gender)j);
-			if (d != "*") {
+			if (d != "*" && fitsForm(d, &tooLong) && ownsForm(*lexicon, d)) {
 				for (auto &c : d) {
-					current = &current->next[c];
+					current = addChild(current, c);
 				}
 				Node n(
-					lemma,
-					{ (Inflection)i, (Gender)j }
+					id,
+					makeTag(AdjQuery{ (Inflection)i, (Gender)j }, lemma.type)
 				);
 				current->lemmas.push_back(n);
+				current->features |= featureBits(n.tag, (Gender)j);
 			}
 		}
 	}
@@ -1110,22 +1272,49 @@ void registerAdjLemma(const AdjLemma &lemma, SearchMap *search_map)
 		}
 		current->adj_lemmas.push_back(lemma);
 	}*/
+	reportLongForms(lemma, tooLong);
+	return id;
+}
+
+// Derived adjectives are indexed by stem and matched on demand instead of
+// having every form put in the trie; see Derived.h.
+const lemma_id_t registerDerivedLemma(const AdjLemma &lemma, Lexicon *lexicon)
+{
+	TRACE_SCOPE("insert");
+	auto id = addLemma(lexicon, lemma);
+	std::vector<std::pair<series_t, tag_t>> forms;
+	size_t tooLong = 0;
+	for (int j = 0; j < 3; j++) {
+		for (int i = 0; i < 14; i++) {
+			auto d = decline(lemma, (Inflection)i, (Gender)j);
+			forms.push_back({ fitsForm(d, &tooLong) ? d.str() : "*", makeTag(AdjQuery{ (Inflection)i, (Gender)j }, lemma.type) });
+		}
+	}
+	if (!addDerived(&lexicon->derived, id, forms))
+		std::cerr << "Derived lemma " << parseSeries(headword(lemma)) << " needs an ending table past the " << UINT16_MAX + 1 << " there is room for and is left out\n";
+	reportLongForms(lemma, tooLong);
+	return id;
 }
 
-void registerVerbLemma(const VerbLemma &lemma, SearchMap *search_map)
+const lemma_id_t registerVerbLemma(const VerbLemma &lemma, Lexicon *lexicon)
 {
+	TRACE_SCOPE("insert");
+	auto id = addLemma(lexicon, lemma);
+	auto search_map = &lexicon->search_map;
+	size_t tooLong = 0;
 	for (int i = 0; i < 104; i++) {
 		auto current = search_map;
 		auto d = conjugate(lemma, (ConjugationSchema)i);
-		if (d != "*") {
+		if (d != "*" && fitsForm(d, &tooLong) && ownsForm(*lexicon, d)) {
 			for (auto &c : d) {
-				current = &current->next[c];
+				current = addChild(current, c);
 			}
 			Node n(
-				lemma,
-				{ (ConjugationSchema)i }
+				id,
+				makeTag(VerbQuery{ (ConjugationSchema)i })
 			);
 			current->lemmas.push_back(n);
+			current->features |= featureBits(n.tag, G_MAS);
 		}
 	}
 	/*auto current = search_map;
@@ -1160,18 +1349,42 @@ void registerVerbLemma(const VerbLemma &lemma, SearchMap *search_map)
 		}
 		current->verb_lemmas.push_back(lemma);
 	}*/
+	reportLongForms(lemma, tooLong);
+	return id;
 }
 
-void readNouns(SearchMap *search_map)
+// Reads the next line of a data file into *line, without its line ending,
+// and sets *lineStart to its byte offset in the file, CRLF endings included.
+const bool readDataLine(std::ifstream &file, std::string *line, size_t *lineStart)
 {
+	*lineStart = (size_t)file.tellg();
+	if (!std::getline(file, *line))
+		return false;
+	if (!line->empty() && line->back() == '\r')
+		line->pop_back();
+	return true;
+}
+
+// Gloss of a data file line whose last column is field.
+const Gloss lineGloss(const uint8_t &source, const size_t &lineStart, const std::string &line, const std::string &field)
+{
+	return { (uint32_t)(lineStart + line.rfind(field)), (uint32_t)field.size(), source };
+}
+
+void readNouns(Lexicon *lexicon)
+{
+	TRACE_SCOPE("readNouns");
 	std::ifstream file;
-	file.open(std::filesystem::current_path() / "data" / "nouns");
+	auto path = std::filesystem::current_path() / "data" / "nouns";
+	file.open(path);
+	uint8_t source = addGlossSource(&lexicon->glosses, path.string());
 	if (!file.is_open()) {
 		std::cerr << "Cannot open noun lemmas\n";
 	}
 
 	std::string line;
-	while (std::getline(file, line)) {
+	size_t lineStart;
+	while (readDataLine(file, &line, &lineStart)) {
 		auto contents = parseTabbedLine(line);
 
 		NounLemma nl = {
@@ -1180,23 +1393,27 @@ void readNouns(SearchMap *search_map)
 			contents[2],
 			(contents[3] == "M" ? G_MAS : (contents[3] == "N" ? G_NEU : G_FEM)),
 			readDeclension(contents[4]),
-			contents[5]
+			lineGloss(source, lineStart, line, contents[5])
 		};
-		registerNounLemma(nl, search_map);
+		registerNounLemma(nl, lexicon);
 	}
 	file.close();
 }
 
-void readAdjs(SearchMap *search_map)
+void readAdjs(Lexicon *lexicon)
 {
+	TRACE_SCOPE("readAdjs");
 	std::ifstream file;
-	file.open(std::filesystem::current_path() / "data" / "adjs");
+	auto path = std::filesystem::current_path() / "data" / "adjs";
+	file.open(path);
+	uint8_t source = addGlossSource(&lexicon->glosses, path.string());
 	if (!file.is_open()) {
 		std::cerr << "Cannot open adj lemmas\n";
 	}
 
 	std::string line;
-	while (std::getline(file, line)) {
+	size_t lineStart;
+	while (readDataLine(file, &line, &lineStart)) {
 		auto contents = parseTabbedLine(line);
 
 		AdjLemma nl = {
@@ -1209,9 +1426,9 @@ void readAdjs(SearchMap *search_map)
 			readDeclension(contents[7]),
 			readDeclension(contents[8]),
 			readDeclension(contents[9]),
-			contents[10]
+			lineGloss(source, lineStart, line, contents[10])
 		};
-		registerAdjLemma(nl, search_map);
+		auto id = registerAdjLemma(nl, lexicon);
 
 		if (contents[5] != "*") {
 			AdjLemma cal = {
@@ -1224,9 +1441,9 @@ void readAdjs(SearchMap *search_map)
 				readDeclension("L3"),
 				readDeclension("L3"),
 				readDeclension("L3N"),
-				"Comparative of " + canonicalForm(nl)
+				derivedGloss(id, D_COMPARATIVE)
 			};
-			registerAdjLemma(cal, search_map);
+			registerDerivedLemma(cal, lexicon);
 		}
 
 		if (contents[6] != "*") {
@@ -1240,24 +1457,28 @@ void readAdjs(SearchMap *search_map)
 				readDeclension("L2M"),
 				readDeclension("L1"),
 				readDeclension("L3N"),
-				"Superlative of " + canonicalForm(nl)
+				derivedGloss(id, D_SUPERLATIVE)
 			};
-			registerAdjLemma(cal, search_map);
+			registerDerivedLemma(cal, lexicon);
 		}
 	}
 	file.close();
 }
 
-void readVerbs(SearchMap *search_map)
+void readVerbs(Lexicon *lexicon)
 {
+	TRACE_SCOPE("readVerbs");
 	std::ifstream file;
-	file.open(std::filesystem::current_path() / "data" / "verbs");
+	auto path = std::filesystem::current_path() / "data" / "verbs";
+	file.open(path);
+	uint8_t source = addGlossSource(&lexicon->glosses, path.string());
 	if (!file.is_open()) {
 		std::cerr << "Cannot open verb lemmas\n";
 	}
 
 	std::string line;
-	while (std::getline(file, line)) {
+	size_t lineStart;
+	while (readDataLine(file, &line, &lineStart)) {
 		auto contents = parseTabbedLine(line);
 
 		VerbLemma vl = {
@@ -1271,9 +1492,9 @@ void readVerbs(SearchMap *search_map)
 			readConjugation(contents[7]),
 			readConjugation(contents[8]),
 			readConjugation(contents[9]),
-			contents[10]
+			lineGloss(source, lineStart, line, contents[10])
 		};
-		registerVerbLemma(vl, search_map);
+		auto id = registerVerbLemma(vl, lexicon);
 
 		if (contents[3] != "*") {
 			AdjLemma cal = {
@@ -1286,9 +1507,9 @@ void readVerbs(SearchMap *search_map)
 				readDeclension("L2M"),
 				readDeclension("L1"),
 				readDeclension("L2N"),
-				"Perfect passive participle or supine of " + canonicalForm(vl)
+				derivedGloss(id, D_PERFECT_PASSIVE)
 			};
-			registerAdjLemma(cal, search_map);
+			registerDerivedLemma(cal, lexicon);
 		}
 
 		if (contents[4] != "*") {
@@ -1302,9 +1523,9 @@ void readVerbs(SearchMap *search_map)
 				readDeclension("L2M"),
 				readDeclension("L1"),
 				readDeclension("L2N"),
-				"Future passive participle or gerundive of " + canonicalForm(vl)
+				derivedGloss(id, D_GERUNDIVE)
 			};
-			registerAdjLemma(cal, search_map);
+			registerDerivedLemma(cal, lexicon);
 		}
 
 		if (contents[5] != "*") {
@@ -1318,9 +1539,9 @@ void readVerbs(SearchMap *search_map)
 				readDeclension("L3I"),
 				readDeclension("L3I"),
 				readDeclension("L3NIA"),
-				"Present active participle of " + canonicalForm(vl)
+				derivedGloss(id, D_PRESENT_ACTIVE)
 			};
-			registerAdjLemma(cal, search_map);
+			auto pid = registerDerivedLemma(cal, lexicon);
 
 			AdjLemma scal = {
 				A_POS,
@@ -1332,9 +1553,9 @@ void readVerbs(SearchMap *search_map)
 				readDeclension("L2M"),
 				readDeclension("L1"),
 				readDeclension("L2N"),
-				"Superlative of " + canonicalForm(cal)
+				derivedGloss(pid, D_SUPERLATIVE)
 			};
-			registerAdjLemma(scal, search_map);
+			registerDerivedLemma(scal, lexicon);
 		}
 
 		if (contents[6] != "*") {
@@ -1348,9 +1569,9 @@ void readVerbs(SearchMap *search_map)
 				readDeclension("L2M"),
 				readDeclension("L1"),
 				readDeclension("L2N"),
-				"Future active participle of " + canonicalForm(vl)
+				derivedGloss(id, D_FUTURE_ACTIVE)
 			};
-			registerAdjLemma(cal, search_map);
+			registerDerivedLemma(cal, lexicon);
 		}
 	}
 	file.close();
@@ -1360,9 +1581,9 @@ const SearchMap *searchSequence(const series_t &s, const SearchMap *search_map)
 {
 	auto current = search_map;
 	for (auto &c : s) {
-		if (current->next.find(c) == current->next.end())
+		current = findChild(current, c);
+		if (current == NULL)
 			return NULL;
-		current = &current->next.at(c);
 	}
 	return current;
 }
@@ -1371,11 +1592,11 @@ const SearchMap *searchSequenceExact(const series_t &s, const SearchMap *search_
 {
 	auto current = search_map;
 	for (auto &c : s) {
-		if (current->next.find(c) == current->next.end())
+		current = findChild(current, c);
+		if (current == NULL)
 			return NULL;
-		current = &current->next.at(c);
 	}
-	if (!current->lemmas.empty())
+	if (hasAnalyses(current))
 		return current;
 	return NULL;
 }
@@ -1393,6 +1614,156 @@ const std::vector<Node> findLemmaSequence(const series_t &s, const SearchMap *se
 	return lemmas;
 }
 
+// The first entry stands for no enclitic.
+const std::vector<series_t> ENCLITICS = { "", "que", "ne", "ve", "cum" };
+
+const uint8_t findEnclitic(const std::string_view &s)
+{
+	for (uint8_t e = 1; e < ENCLITICS.size(); e++) {
+		auto &t = ENCLITICS[e];
+		if (s.size() > t.size() && s.compare(s.size() - t.size(), t.size(), t) == 0)
+			return e;
+	}
+	return 0;
+}
+
+// -ne and -ve also end ordinary forms, the ablatives in -iōne among them, so
+// a word that is a form as it stands is not read as a host with either.
+const bool yieldsToWhole(const uint8_t &enclitic)
+{
+	return ENCLITICS[enclitic] == "ne" || ENCLITICS[enclitic] == "ve";
+}
+
+// Pronouns are declined by the irregular I_* tables and, unlike the irregular
+// nouns (bōs, deus, vīs) that share those tables, have no stem.
+const bool isPronoun(const Lexicon &lexicon, const lemma_id_t &lemma)
+{
+	auto &ref = lexicon.refs[lemma];
+	auto irregular = [](const paradigm_id_t &d) {
+		for (auto &e : DECLS) {
+			if (e.second == d)
+				return e.first.compare(0, 2, "I_") == 0;
+		}
+		return false;
+	};
+	switch (ref.type) {
+		case NOUN: {
+			auto &nl = lexicon.nouns[ref.index];
+			return nl.stem == "*" && irregular(nl.decl);
+		}
+		case ADJECTIVE: {
+			auto &al = lexicon.adjs[ref.index];
+			return al.stem == "*" && irregular(al.mas);
+		}
+		default:
+			return false;
+	}
+}
+
+// -cum goes only on the ablative of a pronoun (quōcum, quibuscum), never on
+// that of a noun (aquā, puellā).
+const bool acceptsEnclitic(const Lexicon &lexicon, const Node &n, const uint8_t &enclitic)
+{
+	if (ENCLITICS[enclitic] != "cum")
+		return true;
+	return tagType(n.tag) != VERB && tagCase(n.tag) == ABL_SG / 2 && isPronoun(lexicon, n.lemma);
+}
+
+// Looks up s as a whole word and, in the same walk, the host left over once
+// a trailing enclitic is cut off; host analyses carry the enclitic, and come
+// only if s is not a form as it stands when the enclitic yieldsToWhole.
+// Derived lemmas are matched separately and merged in by lemma id, which is
+// the order the trie keeps analyses of one form in. Only analyses passing
+// filter are appended to *out; nodes whose feature union fails it are not
+// looked into. Returns whether s is a form as it stands, filter aside, so
+// that what the filter leaves out does not decide which readings come.
+const bool analyzeSequence(const std::string_view &s, const Lexicon &lexicon, const FeatureFilter &filter, std::vector<Analysis> *out)
+{
+	TRACE_SCOPE("probe");
+	auto &dense = lexicon.dense;
+	auto &analyses = *out;
+	uint8_t enclitic = findEnclitic(s);
+	size_t split = s.size() - ENCLITICS[enclitic].size();
+	const SearchMap *host = NULL;
+	uint32_t node = 0;
+	auto current = dense.nodes[0];
+	for (size_t i = 0; i < s.size(); i++) {
+		if (i == split && hasAnalyses(current))
+			host = current;
+		if (i < dense.depth) {
+			node = denseStep(dense, node, s[i]);
+			current = node == 0 ? NULL : dense.nodes[node];
+		} else {
+			current = findChild(current, s[i]);
+		}
+		if (current == NULL)
+			break;
+	}
+	auto add = [&](const SearchMap *find, const std::string_view &form, const uint8_t &enclitic) {
+		TRACE_SCOPE("dedup");
+		size_t start = analyses.size();
+		if (find != NULL && mayMatch(filter, find->features)) {
+			bool all = unfiltered(filter);
+			forEachAnalysis(lexicon.analyses, find, [&](const Node &l) {
+				if (!acceptsEnclitic(lexicon, l, enclitic))
+					return;
+				if (!all && !matches(filter, l, analysisGender(lexicon, l)))
+					return;
+				if (std::find_if(analyses.begin() + start, analyses.end(), [&](const Analysis &a) { return a.node == l; }) == analyses.end())
+					analyses.push_back({ l, enclitic });
+			});
+		}
+		size_t derived = analyses.size();
+		if (ownsForm(lexicon, form)) {
+			matchDerived(lexicon.derived, form, [&](const Node &l) {
+				if (acceptsEnclitic(lexicon, l, enclitic))
+					analyses.push_back({ l, enclitic });
+			}, filter);
+		}
+		auto byLemma = [](const Analysis &a, const Analysis &b) { return a.node.lemma < b.node.lemma; };
+		std::stable_sort(analyses.begin() + derived, analyses.end(), byLemma);
+		std::inplace_merge(analyses.begin() + start, analyses.begin() + derived, analyses.end(), byLemma);
+	};
+	size_t whole = analyses.size();
+	add(current != NULL && hasAnalyses(current) ? current : NULL, s, 0);
+	bool form = analyses.size() > whole || (current != NULL && hasAnalyses(current));
+	if (!form && !unfiltered(filter) && ownsForm(lexicon, s))
+		matchDerived(lexicon.derived, s, [&](const Node &) { form = true; });
+	if (enclitic != 0 && !(yieldsToWhole(enclitic) && form))
+		add(host, s.substr(0, split), enclitic);
+	return form;
+}
+
+const std::vector<Analysis> analyzeSequence(const std::string_view &s, const Lexicon &lexicon, const FeatureFilter &filter = FeatureFilter())
+{
+	std::vector<Analysis> analyses;
+	analyzeSequence(s, lexicon, filter, &analyses);
+	return analyses;
+}
+
+// One filter probe for the folded token, and one more for its host when it
+// ends in an enclitic; false means no candidate of the token is a form.
+const bool mayBeForm(const BloomFilter &bloom, const std::string_view &token)
+{
+	static const auto enclitics = [] {
+		std::vector<std::string> e;
+		for (size_t i = 1; i < ENCLITICS.size(); i++)
+			e.push_back(foldSeries(ENCLITICS[i]));
+		return e;
+	}();
+	char buffer[128];
+	if (token.size() > sizeof(buffer))
+		return true;
+	std::string_view folded(buffer, foldSeries(token, buffer));
+	if (bloomContains(bloom, folded))
+		return true;
+	for (auto &e : enclitics) {
+		if (folded.size() > e.size() && folded.substr(folded.size() - e.size()) == e && bloomContains(bloom, folded.substr(0, folded.size() - e.size())))
+			return true;
+	}
+	return false;
+}
+
 /*const std::vector<std::pair<NounLemma, Inflection>> findNounSequence(const series_t &s, const SearchMap *search_map)
 {
 	std::vector<std::pair<NounLemma, Inflection>> lemmas;
@@ -1466,30 +1837,21 @@ const std::string canonicalForm(const VerbLemma &vl)
 	return parseSeries(conjugate(vl, IND_ACT_SIM_PRE_1SG)) + ", " + parseSeries(conjugate(vl, INF_ACT_PRE)) + ", " + parseSeries(conjugate(vl, IND_ACT_PRF_PRE_1SG)) + ", " + parseSeries(vl.sup_stem + "um");
 }
 
-const std::string canonicalForm(const Node &n)
+const std::string canonicalForm(const Lexicon &lexicon, const lemma_id_t &id)
 {
-	switch (n.type) {
+	auto &ref = lexicon.refs[id];
+	switch (ref.type) {
 		case NOUN:
-			return canonicalForm(n.nounLemma);
+			return canonicalForm(lexicon.nouns[ref.index]);
 		case ADJECTIVE:
-			return canonicalForm(n.adjLemma);
+			return canonicalForm(lexicon.adjs[ref.index]);
 		case VERB:
-			return canonicalForm(n.verbLemma);
+			return canonicalForm(lexicon.verbs[ref.index]);
 		default:
 			return "<error>";
 	}
 }
 
-template<typename T>
-const std::vector<T> addToAll(const std::vector<T> &v, const T &item)
-{
-	std::vector<T> nv;
-	for (auto &e : v) {
-		nv.push_back(e + item);
-	}
-	return nv;
-}
-
 template<typename T>
 const std::vector<T> combine(const std::vector<T> &a, const std::vector<T> &b)
 {
@@ -1500,65 +1862,92 @@ const std::vector<T> combine(const std::vector<T> &a, const std::vector<T> &b)
 	return nv;
 }
 
-const std::vector<series_t> generatePossibilities(const std::string &s, const std::vector<series_t> &prev)
-{
-	if (s.empty())
-		return prev;
-	switch (s[0]) {
-		case 'a': {
-			auto nv = generatePossibilities(s.substr(1), addToAll<series_t>(prev, "a"));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "A")));
-			return nv;
-		}
-		case 'e': {
-			auto nv = generatePossibilities(s.substr(1), addToAll<series_t>(prev, "e"));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "E")));
-			return nv;
-		}
-		case 'i': {
-			auto nv = generatePossibilities(s.substr(1), addToAll<series_t>(prev, "i"));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "I")));
-			return nv;
-		}
-		case 'j': {
-			auto nv = generatePossibilities(s.substr(1), addToAll<series_t>(prev, "i"));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "I")));
-			return nv;
-		}
-		case 'o': {
-			auto nv = generatePossibilities(s.substr(1), addToAll<series_t>(prev, "o"));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "O")));
-			return nv;
-		}
-		case 'u': {
-			auto nv = generatePossibilities(s.substr(1), addToAll<series_t>(prev, "u"));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "U")));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "v")));
-			return nv;
-		}
-		case 'v': {
-			auto nv = generatePossibilities(s.substr(1), addToAll<series_t>(prev, "u"));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "U")));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "v")));
-			return nv;
-		}
-		case 'y': {
-			auto nv = generatePossibilities(s.substr(1), addToAll<series_t>(prev, "y"));
-			nv = combine(nv, generatePossibilities(s.substr(1), addToAll<series_t>(prev, "Y")));
-			return nv;
+// Every spelling of s that leaves vowel length, i/j and u/v open, ordered by
+// the choice at the first letter, then at the second, and so on. Candidates
+// that do not fit a form_t cannot be forms and yield nothing.
+const std::vector<form_t> generatePossibilities(const std::string_view &s)
+{
+	std::vector<form_t> forms(1);
+	size_t length = 0;
+	for (size_t i = 0; i < s.size(); length++) {
+		size_t consumed;
+		char g;
+		auto options = spellingOptions(s.substr(i), &consumed, &g);
+		i += consumed;
+		if (length == form_t::CAPACITY)
+			return {};
+		// Expanded in place from the back, so every prefix is read before
+		// its slot is overwritten.
+		size_t n = forms.size();
+		forms.resize(n * options.size());
+		for (size_t p = n; p-- > 0;) {
+			form_t prefix = forms[p];
+			for (size_t o = 0; o < options.size(); o++) {
+				auto &f = forms[p * options.size() + o];
+				f = prefix;
+				f += options[o];
+			}
 		}
-		default:
-			return generatePossibilities(s.substr(1), addToAll<series_t>(prev, std::string(1, s[0])));
 	}
+	return forms;
 }
 
-void recursivePrint(const SearchMap &map, const int &i)
+/*
+ * The candidates of generatePossibilities(s) that can have an analysis, in
+ * the same order, from one probe of the folded index for s as a whole form
+ * and one for each host s leaves once an enclitic is cut off. They replace
+ * the contents of *out; *key is scratch space.
+ */
+void foldedCandidates(const Lexicon &lexicon, const std::string_view &s, std::string *foldedKey, std::vector<form_t> *out)
 {
-	for (auto &l : map.lemmas) {
+	auto &key = *foldedKey;
+	auto &candidates = *out;
+	candidates.clear();
+	key.resize(s.size());
+	key.resize(foldSeries(s, &key[0]));
+	if (key.size() > form_t::CAPACITY)
+		return;
+	matchFolded(lexicon.folded, s, key, [&](const series_t &f) { candidates.push_back(f); });
+	for (size_t e = 1; e < ENCLITICS.size(); e++) {
+		auto &enclitic = ENCLITICS[e];
+		if (key.size() <= enclitic.size() || key.compare(key.size() - enclitic.size(), enclitic.size(), foldSeries(enclitic)) != 0)
+			continue;
+		// bytes of s spelling the host's letters
+		size_t hostLength = key.size() - enclitic.size();
+		size_t split = 0;
+		for (size_t k = 0; k < hostLength; k++) {
+			size_t consumed;
+			char g;
+			spellingOptions(s.substr(split), &consumed, &g);
+			split += consumed;
+		}
+		if (!spellsText(s.substr(split), enclitic))
+			continue;
+		matchFolded(lexicon.folded, s.substr(0, split), key.substr(0, hostLength), [&](const series_t &f) {
+			form_t candidate = f;
+			candidate += enclitic;
+			candidates.push_back(candidate);
+		});
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const form_t &a, const form_t &b) { return candidateOrder(a, b); });
+	candidates.erase(std::unique(candidates.begin(), candidates.end(), [](const form_t &a, const form_t &b) { return a == std::string_view(b); }), candidates.end());
+}
+
+const std::vector<form_t> foldedCandidates(const Lexicon &lexicon, const std::string_view &s)
+{
+	std::string key;
+	std::vector<form_t> candidates;
+	foldedCandidates(lexicon, s, &key, &candidates);
+	return candidates;
+}
+
+void recursivePrint(const Lexicon &lexicon, const SearchMap &map, const int &i)
+{
+	forEachAnalysis(lexicon.analyses, &map, [&](const Node &l) {
 		for (int j = 0; j < i; j++)
 			std::cout << "\t";
-		std::cout << "NODE: " << canonicalForm(l) << "\n";
-	}
+		std::cout << "NODE: " << canonicalForm(lexicon, l.lemma) << "\n";
+	});
 	/*for (auto &l : map.noun_lemmas) {
 		for (int j = 0; j < i; j++)
 			std::cout << "\t";
@@ -1574,48 +1963,1945 @@ void recursivePrint(const SearchMap &map, const int &i)
 			std::cout << "\t";
 		std::cout << "VERB: " << canonicalForm(l) << "\n";
 	}*/
-	for (auto &e : map.next) {
+	for (size_t k = 0; k < map.next.size(); k++) {
 		for (int j = 0; j < i; j++)
 			std::cout << "\t";
-		std::cout << "MAP: " << e.first << "\n";
-		recursivePrint(e.second, i + 1);
+		std::cout << "MAP: " << childLabel(&map, k) << "\n";
+		recursivePrint(lexicon, map.next[k], i + 1);
+	}
+}
+
+const std::string slotName(const NodeType &type, const size_t &slot)
+{
+	switch (type) {
+		case NOUN:
+			return declensionName((Inflection)slot);
+		case ADJECTIVE:
+			return declensionName((Inflection)(slot % NOUN_SLOTS)) + " " + genderName((Gender)(slot / NOUN_SLOTS));
+		case VERB:
+			return conjugationName((ConjugationSchema)slot);
+		default:
+			return "<error>";
+	}
+}
+
+const std::string typeName(const NodeType &type)
+{
+	switch (type) {
+		case NOUN:
+			return "NOUN";
+		case ADJECTIVE:
+			return "ADJ";
+		case VERB:
+			return "VERB";
+		default:
+			return "<error>";
+	}
+}
+
+// Records formatted per thread in a round of --export's output.
+const size_t EXPORT_SLICE = 4096;
+// Bytes of the binary header and lemma table gathered before each write.
+const size_t EXPORT_BUFFER = 1 << 16;
+
+struct ExportRecord
+{
+	std::string form;
+	lemma_id_t lemma;
+	uint32_t rank;
+	uint16_t slot;
+};
+
+/*
+ * Writes every surface form of the lexicon, one record per (form, lemma,
+ * slot), sorted by form and deduplicated. Homographic lemmas, which print
+ * the same, share their TSV records; the binary format keeps one record per
+ * lemma id. Lemmas are split across threads
+ * in blocks and each thread fills its own buffer; the sorted records are
+ * then formatted in parallel slices and streamed to the file. Forms with a
+ * "*", which the data uses for missing or partly missing forms, are left
+ * out.
+ *
+ * TSV: form, lemma, part of speech and features separated by tabs, one
+ * record per line.
+ *
+ * Binary, every integer little endian whatever the host:
+ *	magic		"LEMX"
+ *	u32		lemma count
+ *	u32		record count
+ *	per lemma, by lemma id:
+ *		u8	part of speech (NodeType: 0 noun, 1 adjective, 2 verb)
+ *		u16	length of the canonical form
+ *		bytes	canonical form, as printed in the TSV
+ *	per record, in TSV order:
+ *		u16	length of the form
+ *		bytes	form
+ *		u32	lemma id, indexing the lemma table
+ *		u16	slot (see slotName): Inflection for nouns, Gender * 14 +
+ *			Inflection for adjectives, ConjugationSchema for verbs
+ *
+ * Strings are the data files' bytes, without terminators. Returns false,
+ * having said why, when a canonical form is too long for its u16 length or
+ * the file cannot be written.
+ */
+const bool exportForms(const Lexicon &lexicon, const std::string &filename, const bool &binary, unsigned threads)
+{
+	static_assert(form_t::CAPACITY <= UINT16_MAX, "export form lengths are u16");
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	const lemma_id_t count = lexicon.refs.size();
+	const lemma_id_t block = 256;
+
+	std::vector<std::string> names(count);
+	std::vector<std::vector<ExportRecord>> buffers(threads);
+	std::atomic<lemma_id_t> cursor(0);
+	auto work = [&](std::vector<ExportRecord> *buffer) {
+		TRACE_SCOPE("generate");
+		while (true) {
+			lemma_id_t start = cursor.fetch_add(block);
+			if (start >= count)
+				break;
+			lemma_id_t end = std::min(count, start + block);
+			for (lemma_id_t id = start; id < end; id++) {
+				names[id] = canonicalForm(lexicon, id);
+				size_t slots = slotCount(lexicon.refs[id].type);
+				for (size_t slot = 0; slot < slots; slot++) {
+					auto d = slotForm(lexicon, id, slot);
+					if (std::find(d.begin(), d.end(), '*') == d.end())
+						buffer->push_back({ parseSeries(d), id, 0, (uint16_t)slot });
+				}
+			}
+		}
+	};
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads; t++) {
+		pool.emplace_back([&, t] {
+			TRACE_THREAD("export " + std::to_string(t));
+			work(&buffers[t]);
+		});
+	}
+	work(&buffers[0]);
+	for (auto &t : pool)
+		t.join();
+
+	// Homographic lemmas print identically, so rank them by canonical form
+	// and let the rank stand in for the lemma when sorting.
+	std::vector<lemma_id_t> order(count);
+	for (lemma_id_t id = 0; id < count; id++)
+		order[id] = id;
+	std::sort(order.begin(), order.end(), [&](const lemma_id_t &a, const lemma_id_t &b) {
+		return names[a] < names[b];
+	});
+	std::vector<uint32_t> ranks(count);
+	for (lemma_id_t i = 0, r = 0; i < count; i++) {
+		if (i > 0 && names[order[i]] != names[order[i - 1]])
+			r++;
+		ranks[order[i]] = r;
+	}
+
+	std::vector<ExportRecord> records;
+	size_t total = 0;
+	for (auto &b : buffers)
+		total += b.size();
+	records.reserve(total);
+	for (auto &b : buffers) {
+		for (auto &r : b) {
+			r.rank = ranks[r.lemma];
+			records.push_back(std::move(r));
+		}
+		std::vector<ExportRecord>().swap(b);
+	}
+	// The lemma id breaks ties after the rank, so homographs stay apart in
+	// the binary format, which names them by id, and collapse in the TSV,
+	// which cannot tell them apart.
+	auto key = [&](const ExportRecord &r) {
+		return std::make_tuple(std::string_view(r.form), r.rank, lexicon.refs[r.lemma].type, r.slot, binary ? r.lemma : 0);
+	};
+	std::sort(records.begin(), records.end(), [&](const ExportRecord &a, const ExportRecord &b) {
+		return key(a) < key(b);
+	});
+	records.erase(std::unique(records.begin(), records.end(), [&](const ExportRecord &a, const ExportRecord &b) {
+		return key(a) == key(b);
+	}), records.end());
+
+	if (binary) {
+		for (lemma_id_t id = 0; id < count; id++) {
+			if (names[id].size() > UINT16_MAX) {
+				std::cerr << "Lemma " << names[id].substr(0, 40) << "... is longer than " << UINT16_MAX << " bytes and cannot be exported\n";
+				return false;
+			}
+		}
+	}
+
+	std::ofstream file(filename, binary ? std::ios::binary : std::ios::out);
+	if (!file.is_open()) {
+		std::cerr << "Cannot open " << filename << "\n";
+		return false;
+	}
+	auto put16 = [](std::string *out, const uint16_t &v) {
+		out->push_back((char)v);
+		out->push_back((char)(v >> 8));
+	};
+	auto put32 = [&](std::string *out, const uint32_t &v) {
+		put16(out, (uint16_t)v);
+		put16(out, (uint16_t)(v >> 16));
+	};
+	auto format = [&](std::string *out, const ExportRecord &r) {
+		if (binary) {
+			put16(out, (uint16_t)r.form.size());
+			out->append(r.form);
+			put32(out, r.lemma);
+			put16(out, r.slot);
+		} else {
+			auto type = lexicon.refs[r.lemma].type;
+			*out += r.form + "\t" + names[r.lemma] + "\t" + typeName(type) + "\t" + slotName(type, r.slot) + "\n";
+		}
+	};
+
+	std::string out;
+	if (binary) {
+		out += "LEMX";
+		put32(&out, count);
+		put32(&out, (uint32_t)records.size());
+		for (lemma_id_t id = 0; id < count; id++) {
+			out.push_back((char)lexicon.refs[id].type);
+			put16(&out, (uint16_t)names[id].size());
+			out += names[id];
+			if (out.size() >= EXPORT_BUFFER) {
+				file.write(out.data(), out.size());
+				out.clear();
+			}
+		}
+		file.write(out.data(), out.size());
+	}
+
+	// Records are formatted a round at a time, a slice per thread, and each
+	// round is written out in order before the next is formatted, so no more
+	// than threads * EXPORT_SLICE records are held as text.
+	std::vector<std::string> chunks(threads);
+	for (size_t round = 0; round < records.size() && file; round += threads * EXPORT_SLICE) {
+		auto slice = [&](const unsigned &t) {
+			TRACE_SCOPE("format");
+			chunks[t].clear();
+			size_t begin = std::min(records.size(), round + t * EXPORT_SLICE);
+			size_t end = std::min(records.size(), begin + EXPORT_SLICE);
+			for (size_t i = begin; i < end; i++)
+				format(&chunks[t], records[i]);
+		};
+		pool.clear();
+		for (unsigned t = 1; t < threads; t++)
+			pool.emplace_back(slice, t);
+		slice(0);
+		for (auto &t : pool)
+			t.join();
+		for (auto &c : chunks)
+			file.write(c.data(), c.size());
+	}
+	file.close();
+	if (!file) {
+		std::cerr << "Cannot write " << filename << "\n";
+		return false;
+	}
+	return true;
+}
+
+void collectForms(const SearchMap *map, series_t *prefix, std::vector<series_t> *forms)
+{
+	if (hasAnalyses(map))
+		forms->push_back(*prefix);
+	for (size_t i = 0; i < map->next.size(); i++) {
+		prefix->push_back(childLabel(map, i));
+		collectForms(&map->next[i], prefix, forms);
+		prefix->pop_back();
+	}
+}
+
+// Every form in the trie and the derived index; the same form may appear
+// more than once.
+const std::vector<series_t> lexiconForms(const Lexicon &lexicon)
+{
+	auto forms = derivedForms(lexicon.derived);
+	forms.erase(std::remove_if(forms.begin(), forms.end(), [&](const series_t &f) { return !ownsForm(lexicon, f); }), forms.end());
+	series_t prefix;
+	collectForms(&lexicon.search_map, &prefix, &forms);
+	return forms;
+}
+
+const BloomFilter buildFormFilter(const Lexicon &lexicon)
+{
+	auto forms = lexiconForms(lexicon);
+	for (auto &f : forms)
+		f = foldSeries(f);
+	std::sort(forms.begin(), forms.end());
+	forms.erase(std::unique(forms.begin(), forms.end()), forms.end());
+	return buildBloom(forms);
+}
+
+// Prints, for each dense cutoff, the size of the flat tables and the mean
+// time of an exact lookup over every form in the lexicon.
+void trieReport(const Lexicon &lexicon)
+{
+	std::vector<series_t> forms;
+	series_t prefix;
+	collectForms(&lexicon.search_map, &prefix, &forms);
+	const size_t rounds = std::max<size_t>(1, 2000000 / std::max<size_t>(1, forms.size()));
+	auto measure = [&](auto &&lookup) {
+		size_t found = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < rounds; r++) {
+			for (auto &f : forms)
+				found += lookup(f) != NULL;
+		}
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		if (found != rounds * forms.size())
+			std::cerr << "Lookup missed " << rounds * forms.size() - found << " forms\n";
+		return elapsed.count() / (rounds * forms.size());
+	};
+	std::cout << "depth\trows\ttable bytes\tns/lookup\n";
+	std::cout << "map\t0\t0\t" << measure([&](const series_t &f) { return searchSequenceExact(f, &lexicon.search_map); }) << "\n";
+	for (uint32_t depth = 0; depth <= 4; depth++) {
+		auto dense = buildDense(&lexicon.search_map, depth);
+		std::cout << depth << "\t" << dense.table.size() / dense.alphabet << "\t" << denseBytes(dense) << "\t" << measure([&](const series_t &f) { return searchSequenceExact(f, dense); }) << "\n";
+	}
+}
+
+void printParadigm(const Lexicon &lexicon, const FormTable &table, const lemma_id_t &id)
+{
+	auto &ref = lexicon.refs[id];
+	auto forms = paradigmTable(table, id);
+	for (size_t slot = 0; slot < forms.size(); slot++) {
+		if (forms[slot] == "*")
+			continue;
+		std::cout << CTEXT(parseSeries(std::string(forms[slot])), BRIGHT_CYAN_TEXT) << "\t";
+		switch (ref.type) {
+			case NOUN:
+				std::cout << CTEXT(declensionName((Inflection)slot), MAGENTA_TEXT) << "\n";
+				break;
+			case ADJECTIVE:
+				std::cout << CTEXT(declensionName((Inflection)(slot % NOUN_SLOTS)), MAGENTA_TEXT) << " " << CTEXT(genderName((Gender)(slot / NOUN_SLOTS)), YELLOW_TEXT) << "\n";
+				break;
+			case VERB:
+				std::cout << CTEXT(conjugationName((ConjugationSchema)slot), MAGENTA_TEXT) << "\n";
+				break;
+		}
 	}
 }
 
-int main()
+const char *DERIVATION_GLOSSES[] = {
+	"Comparative of ",
+	"Superlative of ",
+	"Perfect passive participle or supine of ",
+	"Future passive participle or gerundive of ",
+	"Present active participle of ",
+	"Future active participle of "
+};
+
+const std::string glossText(const Lexicon &lexicon, const Gloss &g)
+{
+	if (g.source == GLOSS_DERIVED)
+		return DERIVATION_GLOSSES[g.length] + canonicalForm(lexicon, g.offset);
+	return std::string(glossView(lexicon.glosses, g));
+}
+
+const Gloss &lemmaGloss(const Lexicon &lexicon, const lemma_id_t &id)
+{
+	auto &ref = lexicon.refs[id];
+	switch (ref.type) {
+		case NOUN:
+			return lexicon.nouns[ref.index].meaning;
+		case ADJECTIVE:
+			return lexicon.adjs[ref.index].meaning;
+		default:
+			return lexicon.verbs[ref.index].meaning;
+	}
+}
+
+void printAnalysis(std::ostream &out, const Lexicon &lexicon, const Analysis &a)
+{
+	auto &l = a.node;
+	auto &ref = lexicon.refs[l.lemma];
+	std::stringstream enclitic;
+	if (a.enclitic != 0)
+		enclitic << CTEXT("+" + parseSeries(ENCLITICS[a.enclitic]), GREEN_TEXT);
+	switch (tagType(l.tag)) {
+		case NOUN:
+			out << CTEXT(parseSeries(decline(lexicon.nouns[ref.index], tagInflection(l.tag))), BRIGHT_CYAN_TEXT) << enclitic.str() << "\t" << CTEXT(declensionName(tagInflection(l.tag)), MAGENTA_TEXT) << " of " << CTEXT(canonicalForm(lexicon, l.lemma), BRIGHT_BLACK_TEXT) << " [NOUN]";
+			break;
+		case ADJECTIVE:
+			out << CTEXT(parseSeries(decline(lexicon.adjs[ref.index], tagInflection(l.tag), tagGender(l.tag))), BRIGHT_CYAN_TEXT) << enclitic.str() << "\t" << CTEXT(declensionName(tagInflection(l.tag)), MAGENTA_TEXT) << " " << CTEXT(genderName(tagGender(l.tag)), YELLOW_TEXT) << " of " << CTEXT(canonicalForm(lexicon, l.lemma), BRIGHT_BLACK_TEXT) << " [ADJ]";
+			break;
+		case VERB:
+			out << CTEXT(parseSeries(conjugate(lexicon.verbs[ref.index], tagSchema(l.tag))), BRIGHT_CYAN_TEXT) << enclitic.str() << "\t" << CTEXT(tagSchema(l.tag), MAGENTA_TEXT) << " of " << CTEXT(canonicalForm(lexicon, l.lemma), BRIGHT_BLACK_TEXT) << " [VERB]";
+			break;
+	}
+	if (GLOSS)
+		out << "\t" << glossText(lexicon, lemmaGloss(lexicon, l.lemma));
+	out << "\n";
+}
+
+size_t TOP = 0;
+FeatureFilter FILTER;
+
+// Buffers kept from token to token, so that analyzing a token allocates
+// nothing once they have grown to fit.
+struct TokenScratch
+{
+	std::string token;
+	std::string key;
+	std::vector<form_t> candidates;
+	std::vector<Analysis> analyses;
+	// this thread's latency histograms, when they are kept
+	TokenLatency *latency = NULL;
+};
+
+// Set when latencies are kept; analyzing threads take their grids from it.
+LatencyRegistry *LATENCY = NULL;
+
+// The result lives in scratch until the next call.
+const std::vector<Analysis> &analyzeToken(const std::string_view &token, const Lexicon &lexicon, TokenScratch *scratch)
+{
+	LatencyTimer timer(scratch->latency, token);
+	auto &lower = scratch->token;
+	lower.assign(token);
+	for (auto &c : lower) {
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+	}
+	auto &fl = scratch->analyses;
+	fl.clear();
+	{
+		TRACE_SCOPE("filter");
+		if (!mayBeForm(lexicon.bloom, lower))
+			return fl;
+	}
+	{
+		TRACE_SCOPE("fold");
+		foldedCandidates(lexicon, lower, &scratch->key, &scratch->candidates);
+	}
+	timer.candidates = scratch->candidates.size();
+	for (auto &p : scratch->candidates)
+		analyzeSequence(p, lexicon, FILTER, &fl);
+	TRACE_SCOPE("rank");
+	selectTop(&fl, TOP);
+	return fl;
+}
+
+const SuffixIndex buildSuffixIndex(const Lexicon &lexicon)
+{
+	return buildSuffixIndex(lexiconForms(lexicon));
+}
+
+// Prints the analyses passing FILTER of every form ending in suffix, forms in
+// rhyme order. As with lookups, unmarked vowels match either length.
+void printSuffixMatches(const Lexicon &lexicon, const SuffixIndex &index, std::string_view suffix)
+{
+	if (!suffix.empty() && suffix[0] == '-')
+		suffix.remove_prefix(1);
+	std::vector<series_t> forms;
+	for (auto &p : generatePossibilities(suffix))
+		matchSuffix(index, p, [&](const series_t &form) { forms.push_back(form); });
+	std::sort(forms.begin(), forms.end(), [](const series_t &a, const series_t &b) {
+		return std::lexicographical_compare(a.rbegin(), a.rend(), b.rbegin(), b.rend());
+	});
+	for (auto &f : forms) {
+		for (auto &a : analyzeSequence(f, lexicon, FILTER)) {
+			if (a.enclitic == 0)
+				printAnalysis(std::cout, lexicon, a);
+		}
+	}
+}
+
+/*
+ * Regression runner (--regress). The differential check regenerates every
+ * form of every lemma, looks each one up in a plain SearchMap holding all
+ * forms (the reference engine) and requires every lookup engine to return
+ * the same analyses; the folded engine also reads each form in the other
+ * spellings a token may have. The timings run fixed workloads and compare
+ * their throughput with data/baseline, lines of "<workload>\t<throughput>".
+ * Throughput is measured relative to a calibration loop timed just before
+ * each workload, so the baseline carries across machines of similar make; a workload
+ * slower than the baseline by more than the threshold fails. Rewrite the
+ * baseline with --write-baseline when a workload changes, or when moving to
+ * a machine whose caches or memory differ widely from the one it was
+ * written on.
+ */
+struct Workload
+{
+	std::string name;
+	double rate;
+	// rate over the calibration loop's, timed just before
+	double relative;
+};
+
+// Every lemma's forms inserted eagerly, derived ones included, as the
+// lexicon was built before derived paradigms were matched on demand.
+const SearchMap buildReferenceTrie(const Lexicon &lexicon, std::vector<series_t> *forms)
+{
+	SearchMap reference;
+	for (lemma_id_t id = 0; id < lexicon.refs.size(); id++) {
+		auto type = lexicon.refs[id].type;
+		for (size_t slot = 0; slot < slotCount(type); slot++) {
+			auto d = slotForm(lexicon, id, slot);
+			if (d == "*")
+				continue;
+			auto current = &reference;
+			for (auto &c : d)
+				current = addChild(current, c);
+			tag_t t = type == NOUN ? makeTag(NounQuery{ (Inflection)slot })
+				: type == ADJECTIVE ? makeTag(AdjQuery{ (Inflection)(slot % NOUN_SLOTS), (Gender)(slot / NOUN_SLOTS) }, lexicon.adjs[lexicon.refs[id].index].type)
+				: makeTag(VerbQuery{ (ConjugationSchema)slot });
+			current->lemmas.push_back(Node(id, t));
+			forms->push_back(d.str());
+		}
+	}
+	std::sort(forms->begin(), forms->end());
+	forms->erase(std::unique(forms->begin(), forms->end()), forms->end());
+	return reference;
+}
+
+// Analyses with their enclitics, in a comparable order.
+const std::vector<std::pair<uint64_t, uint8_t>> analysisKeys(const std::vector<Analysis> &analyses)
+{
+	std::vector<std::pair<uint64_t, uint8_t>> keys;
+	for (auto &a : analyses)
+		keys.push_back({ nodeKey(a.node), a.enclitic });
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
+
+// What analyzeSequence should give for s, read off the reference: the
+// analyses of s as a whole and, unless the enclitic s ends in yieldsToWhole
+// and there are any, those of the host it leaves that accept the enclitic.
+const std::vector<Analysis> referenceAnalyses(const Lexicon &lexicon, const SearchMap &reference, const std::string_view &s)
+{
+	std::vector<Analysis> analyses;
+	for (auto &n : findLemmaSequence(series_t(s), &reference))
+		analyses.push_back({ n, 0 });
+	uint8_t enclitic = findEnclitic(s);
+	if (enclitic != 0 && !(yieldsToWhole(enclitic) && !analyses.empty())) {
+		for (auto &n : findLemmaSequence(series_t(s.substr(0, s.size() - ENCLITICS[enclitic].size())), &reference)) {
+			if (acceptsEnclitic(lexicon, n, enclitic))
+				analyses.push_back({ n, enclitic });
+		}
+	}
+	return analyses;
+}
+
+// The spellings a reader may meet f in: as written, without macrons, and
+// that with u for v, v for u and j for i.
+const std::vector<std::string> tokenSpellings(const series_t &f)
+{
+	// long vowels are the upper case graphemes
+	std::string plain = f;
+	for (auto &c : plain) {
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+	}
+	std::vector<std::string> spellings = { parseSeries(f), plain };
+	for (auto &swap : { std::make_pair('v', 'u'), std::make_pair('u', 'v'), std::make_pair('i', 'j') }) {
+		std::string s = plain;
+		std::replace(s.begin(), s.end(), swap.first, swap.second);
+		spellings.push_back(s);
+	}
+	std::sort(spellings.begin(), spellings.end());
+	spellings.erase(std::unique(spellings.begin(), spellings.end()), spellings.end());
+	return spellings;
+}
+
+/*
+ * The folded engine: analyzeToken's lookup, the folded index's candidates
+ * (foldedCandidates) and analyzeSequence on each, against the expansion it
+ * replaced, generatePossibilities checked against the reference, for every
+ * spelling of f (tokenSpellings). The candidates must come in the same order
+ * and the analyses, enclitic ones included, must agree. Errors are reported
+ * if report is set.
+ */
+const bool foldedAgrees(const Lexicon &lexicon, const SearchMap &reference, const series_t &f, const bool &report)
+{
+	auto isForm = [&](const std::string_view &s) {
+		auto find = searchSequenceExact(series_t(s), &reference);
+		return find != NULL && !find->lemmas.empty();
+	};
+	TokenScratch scratch;
+	for (auto &token : tokenSpellings(f)) {
+		std::vector<std::string> expectedCandidates;
+		std::vector<Analysis> expected;
+		for (auto &p : generatePossibilities(token)) {
+			std::string_view c = p;
+			bool host = false;
+			for (uint8_t e = 1; e < ENCLITICS.size(); e++)
+				host = host || (c.size() > ENCLITICS[e].size() && c.substr(c.size() - ENCLITICS[e].size()) == ENCLITICS[e] && isForm(c.substr(0, c.size() - ENCLITICS[e].size())));
+			if (isForm(c) || host)
+				expectedCandidates.push_back(std::string(c));
+			auto analyses = referenceAnalyses(lexicon, reference, c);
+			expected.insert(expected.end(), analyses.begin(), analyses.end());
+		}
+		std::vector<std::string> candidates;
+		std::vector<Analysis> found;
+		if (mayBeForm(lexicon.bloom, token)) {
+			foldedCandidates(lexicon, token, &scratch.key, &scratch.candidates);
+			for (auto &c : scratch.candidates) {
+				candidates.push_back(std::string(std::string_view(c)));
+				analyzeSequence(c, lexicon, FeatureFilter(), &found);
+			}
+		}
+		if (candidates != expectedCandidates || analysisKeys(found) != analysisKeys(expected)) {
+			if (report)
+				std::cerr << "Engine folded differs from the reference on " << token << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+// Returns the number of words on which some engine disagrees with the
+// reference: every form, and every form with each enclitic, so that host
+// readings are checked as well.
+const size_t differentialCheck(const Lexicon &lexicon, const SearchMap &reference, const std::vector<series_t> &forms)
+{
+	auto withDerived = [&](const SearchMap *find, const std::string_view &s) {
+		std::vector<Analysis> analyses;
+		if (find != NULL)
+			forEachAnalysis(lexicon.analyses, find, [&](const Node &n) { analyses.push_back({ n, 0 }); });
+		matchDerived(lexicon.derived, s, [&](const Node &n) { analyses.push_back({ n, 0 }); });
+		return analyses;
+	};
+	struct Engine
+	{
+		std::string name;
+		// whether the engine reads enclitics, or looks up whole forms only
+		bool enclitics;
+		std::function<std::vector<Analysis>(const series_t &)> analyze;
+	};
+	const std::vector<Engine> engines = {
+		{ "map", false, [&](const series_t &s) { return withDerived(searchSequenceExact(s, &lexicon.search_map), s); } },
+		{ "dense", false, [&](const series_t &s) { return withDerived(searchSequenceExact(s, lexicon.dense), s); } },
+		{ "analyze", true, [&](const series_t &s) { return analyzeSequence(s, lexicon); } },
+		{ "filtered", true, [&](const series_t &s) {
+			 // the parts of speech partition the analyses
+			 std::vector<Analysis> analyses;
+			 for (auto &pos : { "pos=N", "pos=A", "pos=V" }) {
+				 FeatureFilter filter;
+				 std::string error;
+				 parseFilter(lexicon.headwords, pos, &filter, &error);
+				 analyzeSequence(s, lexicon, filter, &analyses);
+			 }
+			 return analyses;
+		 } },
+		{ "bloom", true, [&](const series_t &s) {
+			 // a filter miss would drop every analysis of the word
+			 return mayBeForm(lexicon.bloom, parseSeries(s)) ? referenceAnalyses(lexicon, reference, s) : std::vector<Analysis>();
+		 } }
+	};
+	size_t failures = 0;
+	for (auto &f : forms) {
+		for (auto &enclitic : ENCLITICS) {
+			series_t word = f + enclitic;
+			auto whole = findLemmaSequence(word, &reference);
+			std::vector<Analysis> wholeAnalyses;
+			for (auto &n : whole)
+				wholeAnalyses.push_back({ n, 0 });
+			auto wholeKeys = analysisKeys(wholeAnalyses);
+			auto keys = analysisKeys(referenceAnalyses(lexicon, reference, word));
+			bool differs = false;
+			for (auto &e : engines) {
+				if (analysisKeys(e.analyze(word)) != (e.enclitics ? keys : wholeKeys)) {
+					if (failures < 10)
+						std::cerr << "Engine " << e.name << " differs from the reference on " << parseSeries(word) << "\n";
+					differs = true;
+					break;
+				}
+			}
+			if (!differs && !foldedAgrees(lexicon, reference, word, failures < 10))
+				differs = true;
+			failures += differs;
+		}
+	}
+	return failures;
+}
+
+// Best of five runs, in operations per second.
+template<typename F>
+const double throughput(const size_t &ops, F &&run)
+{
+	double best = 0;
+	for (int r = 0; r < 5; r++) {
+		auto start = std::chrono::steady_clock::now();
+		run();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::max(best, ops / std::max(elapsed.count(), 1e-9));
+	}
+	return best;
+}
+
+const std::vector<Workload> timeWorkloads(const Lexicon &lexicon, const std::vector<series_t> &forms)
+{
+	std::vector<std::string> tokens;
+	std::vector<std::string> unknown;
+	for (auto &f : forms) {
+		tokens.push_back(parseSeries(f));
+		// the form spelt backwards is, but for palindromes, not a form
+		unknown.push_back(std::string(tokens.back().rbegin(), tokens.back().rend()));
+	}
+	const size_t rounds = std::max<size_t>(1, 200000 / std::max<size_t>(1, forms.size()));
+	TokenScratch scratch;
+	size_t sink = 0;
+	std::vector<Workload> workloads;
+	// Hashing and probing in code no engine shares, timed before each
+	// workload so that the workload can be measured against it (see regress).
+	std::unordered_map<std::string, size_t> table;
+	for (auto &t : tokens)
+		table[t] = t.size();
+	auto calibrate = [&] {
+		for (size_t r = 0; r < rounds; r++) {
+			for (auto &t : unknown) {
+				auto it = table.find(t);
+				sink += it != table.end() ? it->second : std::hash<std::string>()(t) & 1;
+			}
+		}
+	};
+	auto time = [&](const std::string &name, const size_t &ops, const std::function<void()> &run) {
+		double calibration = throughput(rounds * unknown.size(), calibrate);
+		double rate = throughput(ops, run);
+		workloads.push_back({ name, rate, rate / calibration });
+	};
+	time("lookup", rounds * forms.size(), [&] {
+		for (size_t r = 0; r < rounds; r++) {
+			for (auto &f : forms)
+				sink += analyzeSequence(f, lexicon).size();
+		}
+	});
+	time("token", rounds * tokens.size(), [&] {
+		for (size_t r = 0; r < rounds; r++) {
+			for (auto &t : tokens)
+				sink += analyzeToken(t, lexicon, &scratch).size();
+		}
+	});
+	time("unknown", rounds * unknown.size(), [&] {
+		for (size_t r = 0; r < rounds; r++) {
+			for (auto &t : unknown)
+				sink += analyzeToken(t, lexicon, &scratch).size();
+		}
+	});
+	if (sink == 0)
+		std::cerr << "No analyses found\n";
+	return workloads;
+}
+
+// Runs the differential check and the timings; returns the exit status.
+const int regress(const Lexicon &lexicon, const double &threshold, const bool &writeBaseline)
+{
+	std::vector<series_t> forms;
+	auto reference = buildReferenceTrie(lexicon, &forms);
+	size_t failures = differentialCheck(lexicon, reference, forms);
+	std::cout << "check\t" << forms.size() << " forms\t" << (failures == 0 ? "ok" : std::to_string(failures) + " differ") << "\n";
+
+	auto path = std::filesystem::current_path() / "data" / "baseline";
+	auto workloads = timeWorkloads(lexicon, forms);
+	if (writeBaseline) {
+		std::ofstream file(path);
+		for (auto &w : workloads)
+			file << w.name << "\t" << w.relative << "\n";
+		std::cout << "Wrote " << path.string() << "\n";
+		return failures == 0 ? 0 : 1;
+	}
+
+	std::unordered_map<std::string, double> baseline;
+	std::ifstream file(path);
+	std::string name;
+	double rate;
+	while (file >> name >> rate)
+		baseline[name] = rate;
+	bool slow = false;
+	std::cout << "workload\tbaseline\trelative\tops/s\tratio\n";
+	for (auto &w : workloads) {
+		auto it = baseline.find(w.name);
+		std::cout << w.name << "\t";
+		if (it == baseline.end()) {
+			std::cout << "-\t" << w.relative << "\t" << (uint64_t)w.rate << "\t-\n";
+			continue;
+		}
+		double ratio = w.relative / it->second;
+		std::cout << it->second << "\t" << w.relative << "\t" << (uint64_t)w.rate << "\t" << ratio;
+		if (ratio < 1 - threshold) {
+			std::cout << "\tSLOWER";
+			slow = true;
+		}
+		std::cout << "\n";
+	}
+	return failures == 0 && !slow ? 0 : 1;
+}
+
+bool AGREE = false;
+
+// Longest run of tokens the agreement pass sees at once when no sentence
+// punctuation comes along.
+const size_t SENTENCE_LIMIT = 1024;
+
+const bool endsSentence(const char *begin, const char *end)
+{
+	for (auto p = begin; p < end; p++) {
+		if (*p == '.' || *p == '!' || *p == '?' || *p == ';' || *p == ':')
+			return true;
+	}
+	return false;
+}
+
+// Where the agreement pass's sentences start in a run of tokens: after
+// sentence punctuation, or after SENTENCE_LIMIT tokens without any. gap points
+// past the last token seen, into text that is still valid; callers reset it
+// to the start of every new buffer of text.
+struct SentenceSplitter
+{
+	const char *gap = NULL;
+	size_t length = 0;
+	bool ended = false;
+
+	const bool starts(const std::string_view &token)
+	{
+		bool start = ended || endsSentence(gap, token.data()) || length == SENTENCE_LIMIT;
+		if (start)
+			length = 0;
+		ended = false;
+		gap = token.data() + token.size();
+		length++;
+		return start;
+	}
+
+	// The text up to end holds no further tokens.
+	void endText(const char *end)
+	{
+		ended = ended || endsSentence(gap, end);
+	}
+};
+
+// Writes one line per analysis, prefixed by its token; tokens without any
+// analysis are written with a "*". With AGREE set, tokens are held back until
+// the end of their sentence and go through the agreement pass first.
+struct BatchWriter
+{
+	const Lexicon &lexicon;
+	std::ostream &out;
+	SentenceSplitter sentences;
+	std::vector<std::string> tokens;
+	std::vector<std::vector<Analysis>> sentence;
+
+	BatchWriter(const Lexicon &lexicon, std::ostream &out) : lexicon(lexicon), out(out)
+	{}
+
+	void print(const std::string_view &token, const std::vector<Analysis> &fl)
+	{
+		TRACE_SCOPE("format");
+		if (fl.empty())
+			out << token << "\t*\n";
+		for (auto &a : fl) {
+			out << token << "\t";
+			printAnalysis(out, lexicon, a);
+		}
+	}
+
+	void flush()
+	{
+		{
+			TRACE_SCOPE("agree");
+			disambiguate(lexicon, &sentence);
+		}
+		for (size_t i = 0; i < tokens.size(); i++)
+			print(tokens[i], sentence[i]);
+		tokens.clear();
+		sentence.clear();
+	}
+
+	// For callers that split sentences themselves.
+	void add(const std::string_view &token, const std::vector<Analysis> &fl, const bool &startsSentence)
+	{
+		if (!AGREE) {
+			print(token, fl);
+			return;
+		}
+		if (startsSentence)
+			flush();
+		tokens.emplace_back(token);
+		sentence.push_back(fl);
+	}
+
+	void add(const std::string_view &token, const std::vector<Analysis> &fl)
+	{
+		add(token, fl, AGREE && sentences.starts(token));
+	}
+
+	void finish()
+	{
+		if (!tokens.empty())
+			flush();
+	}
+};
+
+// Output gathered in a fixed window and handed on one full window at a time.
+struct OutputWindow : std::streambuf
+{
+	std::ostream &sink;
+	std::vector<char> window;
+
+	OutputWindow(std::ostream &sink, const size_t &size) : sink(sink), window(size)
+	{
+		setp(window.data(), window.data() + window.size());
+	}
+
+	~OutputWindow()
+	{
+		sync();
+	}
+
+	int overflow(int c) override
+	{
+		sync();
+		if (c != traits_type::eof()) {
+			*pptr() = (char)c;
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	int sync() override
+	{
+		sink.write(pbase(), pptr() - pbase());
+		setp(window.data(), window.data() + window.size());
+		return sink ? 0 : -1;
+	}
+};
+
+const size_t BATCH_WINDOW = 1 << 20;
+const size_t OUTPUT_WINDOW = 1 << 16;
+
+// A token too long for the input window, which cannot be a form: it is
+// written straight through as it is read, up to the next break byte (see
+// Tokenizer.h), and marked "*". Leading apostrophes
+// are dropped and trailing ones held back until more of the token follows,
+// as trimToken would have it.
+struct OverlongToken
+{
+	bool active = false;
+	bool written = false;
+	size_t apostrophes = 0;
+
+	void start()
+	{
+		active = true;
+		written = false;
+		apostrophes = 0;
+	}
+
+	// Appends to *out what of the next piece of the token can be written.
+	void pass(const char *begin, const char *end, std::string *out)
+	{
+		if (!written) {
+			while (begin < end && *begin == '\'')
+				begin++;
+		}
+		const char *last = end;
+		while (last > begin && last[-1] == '\'')
+			last--;
+		if (last > begin) {
+			out->append(apostrophes, '\'');
+			out->append(begin, last);
+			written = true;
+			apostrophes = 0;
+		}
+		if (written)
+			apostrophes += end - last;
+	}
+
+	void finish(std::string *out)
+	{
+		if (written)
+			*out += "\t*\n";
+		active = false;
+	}
+};
+
+// Whether the process's name field of /proc/self/status (VmRSS, VmHWM) is
+// within maxRss bytes, saying so when it is not; always true for 0.
+const bool withinRss(const char *name, const size_t &maxRss)
+{
+	if (maxRss == 0)
+		return true;
+	size_t rss = procStatus(name);
+	if (rss <= maxRss)
+		return true;
+	std::cerr << "Resident set of " << rss / 1024 << " kB exceeds the limit of " << maxRss / 1024 << " kB\n";
+	return false;
+}
+
+/*
+ * Tokenizes running text from in and writes the analyses of every token, in
+ * memory that does not grow with the input: text is read into a fixed window,
+ * output goes through another, and per-token buffers are reused. A token too
+ * long for the window cannot be a form; it is written straight through as it
+ * is read, marked "*", and ends the sentence for AGREE. With maxRss set (in
+ * bytes), the resident set is checked after every window and at the end, and
+ * going over it fails the run with exit status 1.
+ *
+ * The tokens of each window go to analyzeWindow(tokens, emit) together, which
+ * calls emit(i, analyses) for every token in order.
+ */
+template<typename A>
+const int batch(const Lexicon &lexicon, std::istream &in, std::ostream &out, const size_t &maxRss, A &&analyzeWindow)
+{
+	OutputWindow window(out, OUTPUT_WINDOW);
+	std::ostream windowed(&window);
+	std::string buffer(BATCH_WINDOW, '\0');
+	std::vector<std::string_view> tokens;
+	BatchWriter writer(lexicon, windowed);
+	OverlongToken overlong;
+	std::string piece;
+	auto withinLimit = [&](const char *name) { return withinRss(name, maxRss); };
+	size_t carried = 0;
+	while (true) {
+		in.read(&buffer[carried], buffer.size() - carried);
+		size_t n = carried + in.gcount();
+		bool final = !in;
+		size_t start = 0;
+		if (overlong.active) {
+			while (start < n && !isBreakByte(buffer[start]))
+				start++;
+			piece.clear();
+			overlong.pass(buffer.data(), buffer.data() + start, &piece);
+			if (start < n || final)
+				overlong.finish(&piece);
+			windowed << piece;
+			if (overlong.active) {
+				carried = 0;
+				continue;
+			}
+		}
+		writer.sentences.gap = buffer.data() + start;
+		tokens.clear();
+		size_t used = start + tokenize(std::string_view(buffer.data() + start, n - start), [&](const std::string_view &token) {
+			tokens.push_back(token);
+		}, final);
+		analyzeWindow(tokens, [&](const size_t &i, const std::vector<Analysis> &fl) {
+			writer.add(tokens[i], fl);
+		});
+		writer.sentences.endText(buffer.data() + used);
+		if (final)
+			break;
+		carried = n - used;
+		if (carried == buffer.size()) {
+			writer.finish();
+			overlong.start();
+			piece.clear();
+			overlong.pass(buffer.data(), buffer.data() + n, &piece);
+			windowed << piece;
+			carried = 0;
+		} else {
+			std::copy(buffer.begin() + used, buffer.begin() + n, buffer.begin());
+		}
+		if (!withinLimit("VmRSS"))
+			return 1;
+	}
+	writer.finish();
+	windowed.flush();
+	return withinLimit("VmHWM") ? 0 : 1;
+}
+
+const int batch(const Lexicon &lexicon, std::istream &in, std::ostream &out, const size_t &maxRss = 0)
+{
+	TokenScratch scratch;
+	if (LATENCY != NULL)
+		scratch.latency = LATENCY->add();
+	return batch(lexicon, in, out, maxRss, [&](const std::vector<std::string_view> &tokens, auto &&emit) {
+		for (size_t i = 0; i < tokens.size(); i++)
+			emit(i, analyzeToken(tokens[i], lexicon, &scratch));
+	});
+}
+
+/*
+ * Batch mode as a pipeline (--pipeline): a reader cuts the input into chunks
+ * between tokens, a tokenizer splits them into tokens, analyzer threads
+ * analyze and format whole chunks and a writer puts them back in input order.
+ * Stages pass chunks through bounded queues, so a slow stage stalls the ones
+ * before it instead of letting chunks pile up. Chunks waiting in the writer
+ * for a slow predecessor count too: the tokenizer lets no more than
+ * PIPELINE_DEPTH chunks per analyzer past the last one written. With AGREE
+ * set, the tokenizer regroups tokens so that no sentence is split across
+ * chunks. A token longer than BATCH_WINDOW is passed through by the reader
+ * in pieces, as batch does; the output is the same as batch's either way.
+ * As in batch, maxRss is checked by the writer after every chunk and at the
+ * end; going over it, or failing to write, stops the run with status 1.
+ */
+struct PipelineChunk
+{
+	uint64_t sequence;
+	// a piece of an overlong token, already in output
+	bool passed = false;
+	std::string text;
+	std::vector<std::string_view> tokens;
+	// with AGREE, whether each token starts a sentence
+	std::vector<bool> starts;
+	std::string output;
+};
+
+typedef std::unique_ptr<PipelineChunk> chunk_ptr;
+
+const size_t PIPELINE_CHUNK = 1 << 16;
+const size_t PIPELINE_DEPTH = 8;
+
+// Where a chunk of text may end: after its last break byte, 0 if it has none.
+size_t chunkCut(const std::string_view &text)
+{
+	size_t cut = text.size();
+	while (cut > 0 && !isBreakByte(text[cut - 1]))
+		cut--;
+	return cut;
+}
+
+// Tokens held by the tokenizer until their sentence is complete; text holds
+// their bytes back to back.
+struct HeldTokens
+{
+	std::string text;
+	std::vector<std::pair<size_t, size_t>> spans;
+	std::vector<bool> starts;
+
+	// A chunk of the first n tokens.
+	chunk_ptr take(const size_t &n)
+	{
+		auto chunk = std::make_unique<PipelineChunk>();
+		size_t bytes = n < spans.size() ? spans[n].first : text.size();
+		chunk->text = text.substr(0, bytes);
+		for (size_t i = 0; i < n; i++)
+			chunk->tokens.push_back(std::string_view(chunk->text).substr(spans[i].first, spans[i].second));
+		chunk->starts.assign(starts.begin(), starts.begin() + n);
+		text.erase(0, bytes);
+		spans.erase(spans.begin(), spans.begin() + n);
+		for (auto &s : spans)
+			s.first -= bytes;
+		starts.erase(starts.begin(), starts.begin() + n);
+		return chunk;
+	}
+};
+
+void printStage(std::ostream &out, const char *name, const unsigned &threads, const double &wall, const uint64_t &waitIn, const uint64_t &waitOut)
+{
+	double total = wall * threads;
+	out << std::left << std::setw(12) << name << std::right << std::setw(8) << threads
+		<< std::fixed << std::setprecision(1)
+		<< std::setw(8) << 100 * (total - waitIn - waitOut) / total
+		<< std::setw(10) << 100 * waitIn / total
+		<< std::setw(10) << 100 * waitOut / total << "\n";
+}
+
+void printQueue(std::ostream &out, const char *name, const size_t &capacity, const QueueStats &stats)
+{
+	out << std::left << std::setw(22) << name << std::right << std::setw(8) << capacity << std::setw(8) << stats.pushes
+		<< std::fixed << std::setprecision(2) << std::setw(10) << (stats.pushes ? (double)stats.occupancy / stats.pushes : 0.0) << "\n";
+}
+
+const int pipeline(const Lexicon &lexicon, std::istream &in, std::ostream &out, unsigned analyzers, const bool &stats, const size_t &maxRss)
+{
+	if (analyzers == 0)
+		analyzers = std::max(1u, std::thread::hardware_concurrency());
+	auto start = std::chrono::steady_clock::now();
+	SpscQueue<chunk_ptr> chunks(PIPELINE_DEPTH);
+	MpmcQueue<chunk_ptr> tokenized(PIPELINE_DEPTH);
+	MpmcQueue<chunk_ptr> analyzed(PIPELINE_DEPTH);
+
+	// chunks the writer has written so far
+	std::atomic<uint64_t> written(0);
+	// set by the writer once it stops writing; the reader then ends the input
+	std::atomic<bool> stopped(false);
+	const uint64_t inFlight = PIPELINE_DEPTH * analyzers;
+
+	std::thread reader([&] {
+		TRACE_THREAD("reader");
+		std::string buffer;
+		OverlongToken overlong;
+		auto pass = [&](const size_t &end, const bool &last) {
+			auto chunk = std::make_unique<PipelineChunk>();
+			chunk->passed = true;
+			overlong.pass(buffer.data(), buffer.data() + end, &chunk->output);
+			if (last)
+				overlong.finish(&chunk->output);
+			buffer.erase(0, end);
+			chunks.push(std::move(chunk));
+		};
+		while (true) {
+			size_t carried = buffer.size();
+			buffer.resize(carried + PIPELINE_CHUNK);
+			in.read(&buffer[carried], PIPELINE_CHUNK);
+			buffer.resize(carried + in.gcount());
+			bool final = !in;
+			if (overlong.active) {
+				size_t end = 0;
+				while (end < buffer.size() && !isBreakByte(buffer[end]))
+					end++;
+				pass(end, end < buffer.size() || final);
+			}
+			size_t cut = final ? buffer.size() : chunkCut(buffer);
+			if (cut > 0) {
+				auto chunk = std::make_unique<PipelineChunk>();
+				chunk->text = buffer.substr(0, cut);
+				buffer.erase(0, cut);
+				chunks.push(std::move(chunk));
+			} else if (buffer.size() >= BATCH_WINDOW) {
+				// one run without a break byte too long to be a form
+				overlong.start();
+				pass(buffer.size(), false);
+			}
+			if (final || stopped.load(std::memory_order_relaxed))
+				break;
+		}
+		chunks.close();
+	});
+
+	std::thread tokenizer([&] {
+		TRACE_THREAD("tokenizer");
+		uint64_t sequence = 0;
+		auto send = [&](chunk_ptr c) {
+			c->sequence = sequence++;
+			tokenized.stats.fullNanos += waitUntil([&] { return c->sequence < written.load(std::memory_order_acquire) + inFlight; });
+			tokenized.push(std::move(c));
+		};
+		SentenceSplitter sentences;
+		HeldTokens held;
+		chunk_ptr chunk;
+		while (chunks.pop(&chunk)) {
+			TRACE_SCOPE("tokenize");
+			if (chunk->passed) {
+				// an overlong token ends the sentence before it
+				if (!held.spans.empty())
+					send(held.take(held.spans.size()));
+				send(std::move(chunk));
+				continue;
+			}
+			if (!AGREE) {
+				tokenize(chunk->text, [&](const std::string_view &token) { chunk->tokens.push_back(token); });
+				send(std::move(chunk));
+				continue;
+			}
+			sentences.gap = chunk->text.data();
+			tokenize(chunk->text, [&](const std::string_view &token) {
+				held.starts.push_back(sentences.starts(token));
+				held.spans.push_back({ held.text.size(), token.size() });
+				held.text.append(token);
+			});
+			sentences.endText(chunk->text.data() + chunk->text.size());
+			// pass on the sentences completed so far
+			size_t complete = held.starts.size();
+			while (complete > 0 && !held.starts[complete - 1])
+				complete--;
+			if (complete > 1)
+				send(held.take(complete - 1));
+		}
+		if (!held.spans.empty())
+			send(held.take(held.spans.size()));
+		tokenized.close();
+	});
+
+	std::atomic<unsigned> running(analyzers);
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < analyzers; t++) {
+		workers.emplace_back([&, t] {
+			TRACE_THREAD("analyzer " + std::to_string(t));
+			TokenScratch scratch;
+			if (LATENCY != NULL)
+				scratch.latency = LATENCY->add();
+			chunk_ptr chunk;
+			while (tokenized.pop(&chunk)) {
+				if (chunk->passed) {
+					analyzed.push(std::move(chunk));
+					continue;
+				}
+				std::ostringstream text;
+				BatchWriter writer(lexicon, text);
+				for (size_t i = 0; i < chunk->tokens.size(); i++)
+					writer.add(chunk->tokens[i], analyzeToken(chunk->tokens[i], lexicon, &scratch), AGREE && chunk->starts[i]);
+				writer.finish();
+				chunk->output = text.str();
+				analyzed.push(std::move(chunk));
+			}
+			if (--running == 0)
+				analyzed.close();
+		});
+	}
+
+	{
+		// chunks finished out of order wait here for their predecessors
+		std::map<uint64_t, chunk_ptr> pending;
+		uint64_t next = 0;
+		chunk_ptr chunk;
+		while (analyzed.pop(&chunk)) {
+			pending[chunk->sequence] = std::move(chunk);
+			for (auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it), next++) {
+				TRACE_SCOPE("write");
+				// once stopped, what is left in flight is drained unwritten
+				if (!stopped) {
+					out << it->second->output;
+					if (!out || !withinRss("VmRSS", maxRss))
+						stopped = true;
+				}
+				written.store(next + 1, std::memory_order_release);
+			}
+		}
+	}
+	reader.join();
+	tokenizer.join();
+	for (auto &w : workers)
+		w.join();
+	out.flush();
+	if (!out)
+		std::cerr << "Cannot write the output\n";
+	int status = !stopped && out && withinRss("VmHWM", maxRss) ? 0 : 1;
+
+	if (!stats)
+		return status;
+	double wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cerr << std::left << std::setw(12) << "stage" << std::right << std::setw(8) << "threads" << std::setw(8) << "busy%" << std::setw(10) << "wait-in%" << std::setw(10) << "wait-out%" << "\n";
+	printStage(std::cerr, "reader", 1, wall, 0, chunks.stats.fullNanos);
+	printStage(std::cerr, "tokenizer", 1, wall, chunks.stats.emptyNanos, tokenized.stats.fullNanos);
+	printStage(std::cerr, "analyzer", analyzers, wall, tokenized.stats.emptyNanos, analyzed.stats.fullNanos);
+	printStage(std::cerr, "writer", 1, wall, analyzed.stats.emptyNanos, 0);
+	std::cerr << std::left << std::setw(22) << "queue" << std::right << std::setw(8) << "slots" << std::setw(8) << "chunks" << std::setw(10) << "mean-fill" << "\n";
+	printQueue(std::cerr, "reader->tokenizer", PIPELINE_DEPTH, chunks.stats);
+	printQueue(std::cerr, "tokenizer->analyzer", PIPELINE_DEPTH, tokenized.stats);
+	printQueue(std::cerr, "analyzer->writer", PIPELINE_DEPTH, analyzed.stats);
+	return status;
+}
+
+/*
+ * Serves this process's share of the lexicon (--shard i/n --socket PATH) to
+ * routers, one connection at a time. Each token of a request is looked up as
+ * analyzeToken would, and every candidate with analyses is sent back with
+ * them; ranking is left to the router, which sees all shards' answers. With
+ * parent set, serves a single router and stops once it leaves, or once the
+ * parent process is gone.
+ */
+const int serveShard(const Lexicon &lexicon, const std::string &path, const int &parent = 0)
+{
+	int listener = listenUnix(path);
+	if (listener < 0) {
+		std::cerr << "Cannot listen on " << path << "\n";
+		return 1;
+	}
+	std::string hello;
+	writeVarint(&hello, lexicon.shard);
+	writeVarint(&hello, lexicon.shards);
+	writeVarint(&hello, lexicon.refs.size());
+	TokenScratch scratch;
+	std::vector<size_t> ends;
+	std::vector<bool> forms;
+	std::string request;
+	std::string response;
+	while (!orphaned(parent)) {
+		int router = acceptUnix(listener, 100);
+		if (router < 0)
+			continue;
+		// the router's --filter, when it has one, replaces this process's
+		FeatureFilter filter = FILTER;
+		std::string error;
+		bool ready = writeFrame(router, hello) && readFrame(router, &request);
+		if (ready && !request.empty())
+			ready = parseFilter(lexicon.headwords, request, &filter, &error);
+		if (writeFrame(router, error) && ready) {
+			while (readFrame(router, &request)) {
+				response.clear();
+				auto p = (const uint8_t *)request.data();
+				auto end = p + request.size();
+				std::string_view token;
+				while (p < end) {
+					if (!readBytes(&p, end, &token))
+						break;
+					auto &fl = scratch.analyses;
+					fl.clear();
+					ends.clear();
+					forms.clear();
+					if (mayBeForm(lexicon.bloom, token)) {
+						foldedCandidates(lexicon, token, &scratch.key, &scratch.candidates);
+						for (auto &c : scratch.candidates) {
+							forms.push_back(analyzeSequence(c, lexicon, filter, &fl));
+							ends.push_back(fl.size());
+						}
+					}
+					size_t found = 0;
+					for (size_t i = 0; i < ends.size(); i++)
+						found += forms[i] || ends[i] > (i == 0 ? 0 : ends[i - 1]);
+					writeVarint(&response, found);
+					for (size_t i = 0, start = 0; i < ends.size(); start = ends[i++]) {
+						if (ends[i] == start && !forms[i])
+							continue;
+						std::string_view candidate = scratch.candidates[i];
+						writeVarint(&response, candidate.size());
+						response += candidate;
+						response.push_back((char)forms[i]);
+						writeVarint(&response, ends[i] - start);
+						for (size_t j = start; j < ends[i]; j++)
+							writeAnalysis(&response, fl[j]);
+					}
+				}
+				// a malformed request drops the router like a failed write
+				if (p != end || !writeFrame(router, response))
+					break;
+			}
+		}
+		closeSocket(router);
+		if (parent != 0)
+			break;
+	}
+	closeSocket(listener);
+	removeSocket(path);
+	// a router killed outright cannot clear the directory; the last of its
+	// shards to leave does
+	if (parent != 0)
+		removeSocketDirectory(path);
+	return 0;
+}
+
+/*
+ * The router side of sharded batch mode (--route, --shards). Holding no forms
+ * itself, it sends each window of tokens to the shards, every token to each
+ * shard owning one of its folded keys, and puts the answers back together in
+ * the order a single process gives: by candidate in generatePossibilities
+ * order, the candidate as a whole form before its host. A candidate's whole
+ * form and its host each live in exactly one shard, so that order is all the
+ * merge has to restore, besides dropping the hosts of candidates that the
+ * shard owning them reports to be forms as they stand where the enclitic
+ * yieldsToWhole. TOP is applied to the merged list.
+ */
+struct ShardRouter
+{
+	struct Entry
+	{
+		std::string_view candidate;
+		bool host;
+		Analysis analysis;
+	};
+
+	std::vector<int> sockets;
+	std::vector<std::string> enclitics;
+	std::vector<std::string> requests;
+	std::vector<std::string> responses;
+	// window indices of the tokens sent to each shard
+	std::vector<std::vector<uint32_t>> routed;
+	std::vector<uint32_t> routes;
+	std::string lower;
+	std::string key;
+	std::vector<Entry> entries;
+	// candidates of the token that are forms as they stand
+	std::vector<std::string_view> forms;
+	std::vector<Analysis> fl;
+	bool failed = false;
+
+	~ShardRouter()
+	{
+		close();
+	}
+
+	// Shards started for this router stop once it closes.
+	void close()
+	{
+		for (auto &s : sockets)
+			closeSocket(s);
+		sockets.clear();
+	}
+
+	// Connects to the shards at paths, in shard order, retrying for as long
+	// as running() holds while they load, and has them apply filterSpec.
+	template<typename F>
+	const bool connect(const Lexicon &lexicon, const std::vector<std::string> &paths, const std::string &filterSpec, F &&running)
+	{
+		for (size_t i = 1; i < ENCLITICS.size(); i++)
+			enclitics.push_back(foldSeries(ENCLITICS[i]));
+		std::string hello;
+		for (uint32_t i = 0; i < paths.size(); i++) {
+			int fd;
+			while ((fd = connectUnix(paths[i])) < 0) {
+				if (!running()) {
+					std::cerr << "Cannot connect to shard " << paths[i] << "\n";
+					return false;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			sockets.push_back(fd);
+			if (!readFrame(fd, &hello)) {
+				std::cerr << "No answer from shard " << paths[i] << "\n";
+				return false;
+			}
+			auto p = (const uint8_t *)hello.data();
+			auto end = p + hello.size();
+			uint32_t shard, shards, lemmas;
+			if (!readVarint(&p, end, &shard) || !readVarint(&p, end, &shards) || !readVarint(&p, end, &lemmas)) {
+				std::cerr << "Malformed hello from shard " << paths[i] << "\n";
+				return false;
+			}
+			if (shard != i || shards != paths.size() || lemmas != lexicon.refs.size()) {
+				std::cerr << "Shard " << paths[i] << " serves " << shard << "/" << shards << " of " << lemmas << " lemmas; expected " << i << "/" << paths.size() << " of " << lexicon.refs.size() << "\n";
+				return false;
+			}
+			if (!writeFrame(fd, filterSpec) || !readFrame(fd, &hello) || !hello.empty()) {
+				std::cerr << "Shard " << paths[i] << " cannot apply the filter" << (hello.empty() ? "" : ": " + hello) << "\n";
+				return false;
+			}
+		}
+		requests.resize(sockets.size());
+		responses.resize(sockets.size());
+		routed.resize(sockets.size());
+		return true;
+	}
+
+	// Appends one token's answer from a shard's response to entries and
+	// forms; false when the response ends before the answer does.
+	const bool readResponse(const uint8_t **p, const uint8_t *end)
+	{
+		uint32_t candidates, n;
+		uint8_t form;
+		std::string_view candidate;
+		Analysis a = { Node(0, 0), 0 };
+		if (!readVarint(p, end, &candidates))
+			return false;
+		for (; candidates > 0; candidates--) {
+			if (!readBytes(p, end, &candidate) || !readByte(p, end, &form) || !readVarint(p, end, &n))
+				return false;
+			if (form)
+				forms.push_back(candidate);
+			for (; n > 0; n--) {
+				if (!readAnalysis(p, end, &a))
+					return false;
+				entries.push_back({ candidate, a.enclitic != 0, a });
+			}
+		}
+		return true;
+	}
+
+	// The shards owning the folded keys token may be read under; token is
+	// left lowercased in lower.
+	void route(const std::string_view &token)
+	{
+		lower.assign(token);
+		for (auto &c : lower) {
+			if (c >= 'A' && c <= 'Z')
+				c += 'a' - 'A';
+		}
+		key.resize(lower.size());
+		key.resize(foldSeries(lower, &key[0]));
+		routes.clear();
+		routes.push_back(shardOf(key, sockets.size()));
+		for (auto &e : enclitics) {
+			if (key.size() > e.size() && key.compare(key.size() - e.size(), e.size(), e) == 0)
+				routes.push_back(shardOf(std::string_view(key).substr(0, key.size() - e.size()), sockets.size()));
+		}
+		std::sort(routes.begin(), routes.end());
+		routes.erase(std::unique(routes.begin(), routes.end()), routes.end());
+	}
+
+	template<typename E>
+	void analyze(const std::vector<std::string_view> &tokens, E &&emit)
+	{
+		for (size_t s = 0; s < sockets.size(); s++) {
+			requests[s].clear();
+			routed[s].clear();
+		}
+		for (uint32_t i = 0; i < tokens.size(); i++) {
+			route(tokens[i]);
+			for (auto &s : routes) {
+				writeVarint(&requests[s], lower.size());
+				requests[s] += lower;
+				routed[s].push_back(i);
+			}
+		}
+		bool lost = failed;
+		for (size_t s = 0; s < sockets.size() && !failed; s++)
+			failed = !writeFrame(sockets[s], requests[s]);
+		for (size_t s = 0; s < sockets.size() && !failed; s++)
+			failed = !readFrame(sockets[s], &responses[s]);
+		if (failed) {
+			// the rest of the run is written unanalyzed and fails
+			if (!lost)
+				std::cerr << "Lost a shard\n";
+			for (size_t i = 0; i < tokens.size(); i++)
+				emit(i, std::vector<Analysis>());
+			return;
+		}
+		std::vector<const uint8_t *> cursors;
+		std::vector<size_t> next(sockets.size(), 0);
+		for (auto &r : responses)
+			cursors.push_back((const uint8_t *)r.data());
+		for (uint32_t i = 0; i < tokens.size(); i++) {
+			entries.clear();
+			forms.clear();
+			for (size_t s = 0; s < sockets.size() && !failed; s++) {
+				if (next[s] == routed[s].size() || routed[s][next[s]] != i)
+					continue;
+				next[s]++;
+				failed = !readResponse(&cursors[s], (const uint8_t *)responses[s].data() + responses[s].size());
+			}
+			if (failed) {
+				// a frame cut short counts as a lost shard
+				std::cerr << "Lost a shard\n";
+				for (; i < tokens.size(); i++)
+					emit(i, std::vector<Analysis>());
+				return;
+			}
+			std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+				if (a.candidate != b.candidate)
+					return candidateOrder(a.candidate, b.candidate);
+				return a.host < b.host;
+			});
+			fl.clear();
+			for (auto &e : entries) {
+				if (!(e.host && yieldsToWhole(e.analysis.enclitic) && std::find(forms.begin(), forms.end(), e.candidate) != forms.end()))
+					fl.push_back(e.analysis);
+			}
+			selectTop(&fl, TOP);
+			emit(i, fl);
+		}
+	}
+};
+
+// Reads the number given to option into *out; reports it and returns false
+// unless all of text is a number within [min, max], and a whole one where T
+// is an integer type.
+template<typename T>
+const bool parseOption(const std::string &option, const std::string &text, const double &min, const double &max, T *out)
+{
+	size_t used = 0;
+	double v = 0;
+	try {
+		v = std::stod(text, &used);
+	} catch (const std::exception &) {
+		used = 0;
+	}
+	if (used == 0 || used != text.size() || !(v >= min && v <= max) || (std::is_integral<T>::value && v != std::floor(v))) {
+		std::cerr << "Bad value " << text << " for " << option << " (expected " << (std::is_integral<T>::value ? "a whole number" : "a number") << " from " << (long long)min << " to " << (long long)max << ")\n";
+		return false;
+	}
+	*out = (T)v;
+	return true;
+}
+
+int main(int argc, char **argv)
 {
 #ifdef _WIN32
 	SetConsoleOutputCP(65001);
 	SetConsoleCP(65001);
 #endif
-	SearchMap search_map;
-	readNouns(&search_map);
-	readAdjs(&search_map);
-	readVerbs(&search_map);
-	//recursivePrint(search_map, 0);
+	std::vector<std::string> paradigms;
+	std::vector<std::string> suffixes;
+	std::string exportFile;
+	bool exportBinary = false;
+	unsigned threads = 0;
+	bool batchMode = false;
+	bool pipelineMode = false;
+	bool pipelineStats = false;
+	bool report = false;
+	bool memstats = false;
+	std::string traceFile;
+	std::string filterSpec;
+	bool regression = false;
+	bool writeBaseline = false;
+	double threshold = 0.25;
+	size_t maxRss = 0;
+	bool latencyReport = false;
+	std::string latencyFile;
+	int latencyPort = 0;
+	std::string latencySlo;
+	std::string shardSpec;
+	std::string socketPath;
+	std::vector<std::string> routePaths;
+	uint32_t spawnShards = 0;
+	uint32_t denseDepth = LEMMA_DENSE_DEPTH;
+	std::string freqFile;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--paradigm" && i + 1 < argc) {
+			paradigms.push_back(argv[++i]);
+		} else if (arg == "--suffix" && i + 1 < argc) {
+			suffixes.push_back(argv[++i]);
+		} else if (arg == "--export" && i + 1 < argc) {
+			exportFile = argv[++i];
+		} else if (arg == "--binary") {
+			exportBinary = true;
+		} else if (arg == "--batch") {
+			batchMode = true;
+		} else if (arg == "--pipeline") {
+			pipelineMode = true;
+		} else if (arg == "--pipeline-stats") {
+			pipelineMode = true;
+			pipelineStats = true;
+		} else if (arg == "--filter" && i + 1 < argc) {
+			filterSpec = argv[++i];
+		} else if (arg == "--agree") {
+			AGREE = true;
+		} else if (arg == "--no-color") {
+			COLOR = false;
+		} else if (arg == "--gloss") {
+			GLOSS = true;
+		} else if (arg == "--dense-depth" && i + 1 < argc) {
+			if (!parseOption(arg, argv[++i], 0, 16, &denseDepth))
+				return 1;
+		} else if (arg == "--trie-report") {
+			report = true;
+		} else if (arg == "--memstats") {
+			memstats = true;
+		} else if (arg == "--trace" && i + 1 < argc) {
+			traceFile = argv[++i];
+		} else if (arg == "--regress") {
+			regression = true;
+		} else if (arg == "--write-baseline") {
+			regression = true;
+			writeBaseline = true;
+		} else if (arg == "--max-rss" && i + 1 < argc) {
+			if (!parseOption(arg, argv[++i], 1, 1 << 30, &maxRss))
+				return 1;
+			maxRss <<= 20;
+		} else if (arg == "--shard" && i + 1 < argc) {
+			shardSpec = argv[++i];
+		} else if (arg == "--socket" && i + 1 < argc) {
+			socketPath = argv[++i];
+		} else if (arg == "--route" && i + 1 < argc) {
+			routePaths.push_back(argv[++i]);
+		} else if (arg == "--shards" && i + 1 < argc) {
+			if (!parseOption(arg, argv[++i], 1, 1024, &spawnShards))
+				return 1;
+		} else if (arg == "--latency") {
+			latencyReport = true;
+		} else if (arg == "--latency-out" && i + 1 < argc) {
+			latencyFile = argv[++i];
+		} else if (arg == "--latency-port" && i + 1 < argc) {
+			if (!parseOption(arg, argv[++i], 1, 65535, &latencyPort))
+				return 1;
+		} else if (arg == "--latency-slo" && i + 1 < argc) {
+			latencySlo = argv[++i];
+		} else if (arg == "--threshold" && i + 1 < argc) {
+			if (!parseOption(arg, argv[++i], 0, 1000, &threshold))
+				return 1;
+			threshold /= 100;
+		} else if (arg == "--freq" && i + 1 < argc) {
+			freqFile = argv[++i];
+		} else if (arg == "--top" && i + 1 < argc) {
+			if (!parseOption(arg, argv[++i], 0, 1 << 20, &TOP))
+				return 1;
+		} else if (arg == "--threads" && i + 1 < argc) {
+			if (!parseOption(arg, argv[++i], 0, 1024, &threads))
+				return 1;
+		} else {
+			std::cerr << "Unknown argument " << arg << "\n";
+			return 1;
+		}
+	}
+
+	std::vector<LatencyObjective> objectives;
+	if (!latencySlo.empty() && !parseLatencySlo(latencySlo, &objectives, std::cerr))
+		return 1;
+
+	uint32_t shard = 0;
+	uint32_t shards = 0;
+	if (!shardSpec.empty() && !parseShard(shardSpec, &shard, &shards)) {
+		std::cerr << "Bad shard " << shardSpec << " (expected i/n with i < n)\n";
+		return 1;
+	}
+	// checked before any shards are made, which would each report it
+	if (!freqFile.empty() && !std::ifstream(freqFile).is_open()) {
+		std::cerr << "Cannot open " << freqFile << "\n";
+		return 1;
+	}
+	ShardProcesses processes;
+	int parent = 0;
+	if (spawnShards > 0) {
+		parent = processId();
+		shards = spawnShards;
+		shard = forkShards(&processes, shards);
+		if (shard < shards) {
+			socketPath = shardSocket(processes, shard);
+			traceFile.clear();
+		} else if (processes.pids.size() != shards) {
+			std::cerr << "Cannot start " << shards << " shard processes\n";
+			stopShards(&processes);
+			return 1;
+		} else {
+			parent = 0;
+			for (uint32_t i = 0; i < shards; i++)
+				routePaths.push_back(shardSocket(processes, i));
+		}
+	}
+	if (!routePaths.empty()) {
+		// the router keeps no forms of its own
+		shards = routePaths.size();
+		shard = shards;
+	}
+
+	// Written on the way out of main, whichever mode ran.
+	struct TraceFile
+	{
+		std::string name;
+		~TraceFile()
+		{
+			if (!name.empty() && !writeTrace(name))
+				std::cerr << "Cannot write trace " << name << " (tracing needs a build with -DLEMMA_TRACE)\n";
+		}
+	} trace = { traceFile };
+	TRACE_THREAD("main");
+
+	Lexicon lexicon;
+	lexicon.shard = shard;
+	lexicon.shards = shards;
+	readNouns(&lexicon);
+	readAdjs(&lexicon);
+	readVerbs(&lexicon);
+	if (!freqFile.empty()) {
+		TRACE_SCOPE("frequencies");
+		Frequencies freq;
+		if (!readFrequencies(lexicon, freqFile, &freq)) {
+			if (!processes.pids.empty())
+				stopShards(&processes);
+			return 1;
+		}
+		applyFrequencies(&lexicon.search_map, freq);
+		applyFrequencies(&lexicon.derived, freq);
+	}
+	{
+		TRACE_SCOPE("packAnalyses");
+		lexicon.analyses = packAnalyses(&lexicon.search_map);
+	}
+	{
+		TRACE_SCOPE("buildDense");
+		lexicon.dense = buildDense(&lexicon.search_map, denseDepth);
+	}
+	{
+		TRACE_SCOPE("buildBloom");
+		lexicon.bloom = buildFormFilter(lexicon);
+	}
+	{
+		TRACE_SCOPE("buildFolded");
+		lexicon.folded = buildFoldedIndex(lexiconForms(lexicon));
+	}
+	//recursivePrint(lexicon, lexicon.search_map, 0);
+
+	if (!filterSpec.empty()) {
+		std::string error;
+		if (!parseFilter(lexicon.headwords, filterSpec, &FILTER, &error)) {
+			std::cerr << error << "\n";
+			if (!processes.pids.empty())
+				stopShards(&processes);
+			return 1;
+		}
+	}
+
+	if (!socketPath.empty()) {
+		if (shards == 0) {
+			std::cerr << "--socket needs --shard\n";
+			return 1;
+		}
+		return serveShard(lexicon, socketPath, parent);
+	}
+
+	if (!routePaths.empty()) {
+		COLOR = false;
+		ShardRouter router;
+		if (!router.connect(lexicon, routePaths, filterSpec, [&] { return !processes.pids.empty() && shardsRunning(processes); })) {
+			stopShards(&processes);
+			return 1;
+		}
+		int status = batch(lexicon, std::cin, std::cout, maxRss, [&](const std::vector<std::string_view> &tokens, auto &&emit) {
+			router.analyze(tokens, emit);
+		});
+		if (router.failed) {
+			stopShards(&processes);
+			return 1;
+		}
+		router.close();
+		reapShards(&processes);
+		return status;
+	}
+
+	if (regression)
+		return regress(lexicon, threshold, writeBaseline);
+
+	if (memstats) {
+		memoryReport(lexicon, std::cout);
+		return 0;
+	}
+
+	if (report) {
+		trieReport(lexicon);
+		return 0;
+	}
+
+	if (!exportFile.empty()) {
+		return exportForms(lexicon, exportFile, exportBinary, threads) ? 0 : 1;
+	}
+
+	if (pipelineMode || batchMode) {
+		COLOR = false;
+		LatencyRegistry registry;
+		MetricsEndpoint endpoint(registry);
+		if (latencyReport || !latencyFile.empty() || latencyPort != 0 || !latencySlo.empty())
+			LATENCY = &registry;
+		if (latencyPort != 0 && !endpoint.start(latencyPort)) {
+			std::cerr << "Cannot serve latency metrics on port " << latencyPort << "\n";
+			return 1;
+		}
+		int status = 0;
+		if (pipelineMode)
+			status = pipeline(lexicon, std::cin, std::cout, threads, pipelineStats, maxRss);
+		else
+			status = batch(lexicon, std::cin, std::cout, maxRss);
+		if (latencyReport)
+			printLatency(registry, std::cerr);
+		if (!latencyFile.empty()) {
+			std::ofstream file(latencyFile);
+			file << latencyMetrics(registry);
+			if (!file) {
+				std::cerr << "Cannot write " << latencyFile << "\n";
+				status = 1;
+			}
+		}
+		if (!objectives.empty() && !checkLatencySlo(registry, objectives, std::cerr))
+			status = 1;
+		LATENCY = NULL;
+		return status;
+	}
+
+	if (!suffixes.empty()) {
+		auto index = buildSuffixIndex(lexicon);
+		for (auto &x : suffixes)
+			printSuffixMatches(lexicon, index, x);
+		return 0;
+	}
+
+	if (!paradigms.empty()) {
+		auto table = buildFormTable(lexicon);
+		for (auto &w : paradigms) {
+			for (auto &p : generatePossibilities(w)) {
+				for (auto &id : findHeadword(lexicon, p.str())) {
+					std::cout << CTEXT(canonicalForm(lexicon, id), BRIGHT_BLACK_TEXT) << "\n";
+					printParadigm(lexicon, table, id);
+				}
+			}
+		}
+		return 0;
+	}
 
 	while (true) {
 		std::string line;
 		std::cout << "LAT> ";
-		std::getline(std::cin, line);
-		auto ps = generatePossibilities(line, { "" });
-		std::vector<Node> fl;
-		for (auto &p : ps) {
-			fl = combine(fl, findLemmaSequence(p, &search_map));
+		if (!std::getline(std::cin, line))
+			break;
+		if (!mayBeForm(lexicon.bloom, line))
+			continue;
+		std::vector<form_t> ps;
+		{
+			TRACE_SCOPE("fold");
+			ps = foldedCandidates(lexicon, line);
 		}
-		for (auto &l : fl) {
-			switch (l.type) {
-				case NOUN:
-					std::cout << CTEXT(parseSeries(decline(l.nounLemma, l.nounQuery.i)), BRIGHT_CYAN_TEXT) << "\t" << CTEXT(declensionName(l.nounQuery.i), MAGENTA_TEXT) << " of " << CTEXT(canonicalForm(l), BRIGHT_BLACK_TEXT) << " [NOUN]\n";
-					break;
-				case ADJECTIVE:
-					std::cout << CTEXT(parseSeries(decline(l.adjLemma, l.adjQuery.i, l.adjQuery.g)), BRIGHT_CYAN_TEXT) << "\t" << CTEXT(declensionName(l.adjQuery.i), MAGENTA_TEXT) << " " << CTEXT(genderName(l.adjQuery.g), YELLOW_TEXT) << " of " << CTEXT(canonicalForm(l), BRIGHT_BLACK_TEXT) << " [ADJ]\n";
-					break;
-				case VERB:
-					std::cout << CTEXT(parseSeries(conjugate(l.verbLemma, l.verbQuery.c)), BRIGHT_CYAN_TEXT) << "\t" << CTEXT(l.verbQuery.c, MAGENTA_TEXT) << " of " << CTEXT(canonicalForm(l), BRIGHT_BLACK_TEXT) << " [VERB]\n";
-					break;
-			}
+		std::vector<Analysis> fl;
+		for (auto &p : ps) {
+			fl = combine(fl, analyzeSequence(p, lexicon, FILTER));
 		}
+		selectTop(&fl, TOP);
+		TRACE_SCOPE("format");
+		for (auto &a : fl)
+			printAnalysis(std::cout, lexicon, a);
 	}
 	return 0;
 }
\ No newline at end of file
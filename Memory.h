@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "Lexicon.h"
+#include "Tag.h"
+
+/*
+ * Byte accounting for --memstats. Sizes are what the containers hold on to
+ * (capacities, not sizes), and strings only count their heap buffer when
+ * they have outgrown the inline one; sizeof of the owning object is charged
+ * to whatever contains it. Hash tables are estimated from their bucket and
+ * element counts, since the node layout is not visible.
+ */
+
+inline const size_t heapBytes(const std::string &s)
+{
+	auto p = (const char *)&s;
+	if (s.data() >= p && s.data() < p + sizeof(s))
+		return 0;
+	return s.capacity() + 1;
+}
+
+template<typename T>
+inline const size_t vectorBytes(const std::vector<T> &v)
+{
+	return v.capacity() * sizeof(T);
+}
+
+inline const size_t heapBytes(const DPair &p)
+{
+	return heapBytes(p.sg) + heapBytes(p.pl);
+}
+
+inline const size_t heapBytes(const CTuple &t)
+{
+	return heapBytes(t._1sg) + heapBytes(t._2sg) + heapBytes(t._3sg) + heapBytes(t._1pl) + heapBytes(t._2pl) + heapBytes(t._3pl);
+}
+
+inline const size_t heapBytes(const Declension &d)
+{
+	return heapBytes(d.name) + heapBytes(d.nom) + heapBytes(d.gen) + heapBytes(d.dat) + heapBytes(d.acc) + heapBytes(d.abl) + heapBytes(d.voc) + heapBytes(d.loc);
+}
+
+inline const size_t heapBytes(const Conjugation &c)
+{
+	return heapBytes(c.name) + heapBytes(c.inf) + heapBytes(c.imp1) + heapBytes(c.imp2) + heapBytes(c.imp3)
+		+ heapBytes(c.ind_pres) + heapBytes(c.ind_impf) + heapBytes(c.ind_fut) + heapBytes(c.sub_pres) + heapBytes(c.sub_impf);
+}
+
+inline const size_t heapBytes(const NounLemma &nl)
+{
+	return heapBytes(nl.lemma) + heapBytes(nl.genov) + heapBytes(nl.stem);
+}
+
+inline const size_t heapBytes(const AdjLemma &al)
+{
+	return heapBytes(al.mlemma) + heapBytes(al.flemma) + heapBytes(al.nlemma) + heapBytes(al.stem) + heapBytes(al.suffix);
+}
+
+inline const size_t heapBytes(const VerbLemma &vl)
+{
+	return heapBytes(vl.sim_stem) + heapBytes(vl.prf_stem) + heapBytes(vl.extra_stem) + heapBytes(vl.sup_stem)
+		+ heapBytes(vl.ger_stem) + heapBytes(vl.prs_act_part_stem) + heapBytes(vl.prs_fut_part_stem);
+}
+
+struct TrieBytes
+{
+	size_t nodes = 0;
+	size_t nodeBytes = 0;
+	size_t analyses = 0;
+	size_t analysisBytes = 0;
+	// by the POS bits of the tag; meaningless for the derived stem index
+	size_t byPos[4] = { 0 };
+	std::vector<uint32_t> leaves;
+};
+
+// The root is a member of its owner; every other node is an element of its
+// parent's child vector and is counted there. Packed analyses are counted
+// but their bytes are the table's.
+inline void measureTrie(const AnalysisTable &table, const SearchMap *map, TrieBytes *t)
+{
+	t->nodes++;
+	t->nodeBytes += heapBytes(map->spill) + vectorBytes(map->next);
+	t->analysisBytes += vectorBytes(map->lemmas);
+	size_t n = 0;
+	forEachAnalysis(table, map, [&](const Node &l) {
+		t->byPos[tagType(l.tag)]++;
+		n++;
+	});
+	t->analyses += n;
+	if (n != 0)
+		t->leaves.push_back(n);
+	for (auto &c : map->next)
+		measureTrie(table, &c, t);
+}
+
+// Analyses of derived lemmas by part of speech; the stem index keeps table
+// ids, not tags, in its nodes.
+inline void measureDerived(const DerivedIndex &index, const SearchMap *map, size_t *byPos)
+{
+	for (auto &n : map->lemmas) {
+		for (auto &e : index.tables[n.tag].endings)
+			byPos[tagType(e.second)]++;
+	}
+	for (auto &c : map->next)
+		measureDerived(index, &c, byPos);
+}
+
+template<typename K, typename V>
+inline const size_t hashBytes(const std::unordered_map<K, V> &m)
+{
+	// one bucket pointer per bucket; per element the value, a next pointer
+	// and the cached hash
+	return m.bucket_count() * sizeof(void *) + m.size() * (sizeof(std::pair<const K, V>) + sizeof(void *) + sizeof(size_t));
+}
+
+// Value of a "Name:   123 kB" line of /proc/self/status, in bytes; 0 where
+// there is no such file.
+inline const size_t procStatus(const std::string &name)
+{
+	std::ifstream file("/proc/self/status");
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.compare(0, name.size() + 1, name + ":") == 0)
+			return std::stoull(line.substr(name.size() + 1)) * 1024;
+	}
+	return 0;
+}
+
+inline void memoryReport(const Lexicon &lexicon, std::ostream &out)
+{
+	TrieBytes trie;
+	measureTrie(lexicon.analyses, &lexicon.search_map, &trie);
+	TrieBytes stems;
+	measureTrie(lexicon.analyses, &lexicon.derived.stems, &stems);
+	size_t derived[4] = { 0 };
+	measureDerived(lexicon.derived, &lexicon.derived.stems, derived);
+
+	size_t endings = 0;
+	size_t endingBytes = vectorBytes(lexicon.derived.tables);
+	for (auto &t : lexicon.derived.tables) {
+		endings += t.endings.size();
+		endingBytes += vectorBytes(t.endings);
+		for (auto &e : t.endings)
+			endingBytes += heapBytes(e.first);
+	}
+	endingBytes += hashBytes(lexicon.derived.tableIds);
+	for (auto &ids : lexicon.derived.tableIds)
+		endingBytes += vectorBytes(ids.second);
+
+	size_t lemmaBytes[3] = {
+		vectorBytes(lexicon.nouns),
+		vectorBytes(lexicon.adjs),
+		vectorBytes(lexicon.verbs)
+	};
+	for (auto &l : lexicon.nouns)
+		lemmaBytes[NOUN] += heapBytes(l);
+	for (auto &l : lexicon.adjs)
+		lemmaBytes[ADJECTIVE] += heapBytes(l);
+	for (auto &l : lexicon.verbs)
+		lemmaBytes[VERB] += heapBytes(l);
+
+	size_t headwordBytes = hashBytes(lexicon.headwords);
+	for (auto &h : lexicon.headwords)
+		headwordBytes += heapBytes(h.first) + vectorBytes(h.second);
+
+	size_t paradigmBytes = vectorBytes(DECLENSIONS) + vectorBytes(CONJUGATIONS);
+	for (auto &d : DECLENSIONS)
+		paradigmBytes += heapBytes(d);
+	for (auto &c : CONJUGATIONS)
+		paradigmBytes += heapBytes(c);
+
+	size_t glosses = 0;
+	size_t glossText = 0;
+	auto addGloss = [&](const Gloss &g) {
+		if (g.source != GLOSS_NONE && g.source != GLOSS_DERIVED) {
+			glosses++;
+			glossText += g.length;
+		}
+	};
+	for (auto &l : lexicon.nouns)
+		addGloss(l.meaning);
+	for (auto &l : lexicon.adjs)
+		addGloss(l.meaning);
+	for (auto &l : lexicon.verbs)
+		addGloss(l.meaning);
+	size_t mapped = 0;
+	size_t glossMapped = 0;
+	size_t glossFiles = 0;
+	for (auto &f : lexicon.glosses.files) {
+		mapped += f.data != NULL;
+		glossMapped += f.size;
+		std::error_code error;
+		auto size = std::filesystem::file_size(f.path, error);
+		if (!error)
+			glossFiles += size;
+	}
+
+	out << "component\tcount\tbytes\n";
+	out << "trie nodes\t" << trie.nodes << "\t" << trie.nodeBytes << "\n";
+	out << "trie analyses\t" << trie.analyses << "\t" << trie.analysisBytes << "\n";
+	out << "analysis sets\t" << lexicon.analyses.sets << "\t" << vectorBytes(lexicon.analyses.leaves) << "\n";
+	out << "analysis patterns\t" << lexicon.analyses.patternCount << "\t" << vectorBytes(lexicon.analyses.patterns) + vectorBytes(lexicon.analyses.tags) << "\n";
+	out << "dense tables\t" << lexicon.dense.table.size() << "\t" << denseBytes(lexicon.dense) << "\n";
+	out << "derived stems\t" << stems.nodes << "\t" << stems.nodeBytes + stems.analysisBytes << "\n";
+	out << "derived endings\t" << endings << "\t" << endingBytes + hashBytes(lexicon.derived.weights) << "\n";
+	size_t foldedBytes = hashBytes(lexicon.folded.keys) + vectorBytes(lexicon.folded.forms);
+	for (auto &k : lexicon.folded.keys)
+		foldedBytes += heapBytes(k.first);
+	for (auto &f : lexicon.folded.forms)
+		foldedBytes += heapBytes(f);
+	out << "folded index\t" << lexicon.folded.keys.size() << "\t" << foldedBytes << "\n";
+	out << "bloom filter\t" << lexicon.bloom.words.size() << "\t" << vectorBytes(lexicon.bloom.words) << "\n";
+	out << "lemma refs\t" << lexicon.refs.size() << "\t" << vectorBytes(lexicon.refs) << "\n";
+	out << "lemma payload\t" << lexicon.refs.size() << "\t" << lemmaBytes[NOUN] + lemmaBytes[ADJECTIVE] + lemmaBytes[VERB] << "\n";
+	out << "headword index\t" << lexicon.headwords.size() << "\t" << headwordBytes << "\n";
+	out << "paradigms\t" << DECLENSIONS.size() + CONJUGATIONS.size() << "\t" << paradigmBytes << "\n";
+	out << "gloss text\t" << glosses << "\t" << glossText << "\n";
+	out << "gloss files\t" << lexicon.glosses.files.size() << "\t" << glossFiles << "\n";
+	out << "gloss files mapped\t" << mapped << "\t" << glossMapped << "\n";
+
+	static const char *POS[] = { "NOUN", "ADJ", "VERB" };
+	out << "\npos\tlemmas\tanalyses\tderived\tlemma bytes\n";
+	size_t lemmas[3] = { lexicon.nouns.size(), lexicon.adjs.size(), lexicon.verbs.size() };
+	for (int p = 0; p < 3; p++)
+		out << POS[p] << "\t" << lemmas[p] << "\t" << trie.byPos[p] << "\t" << derived[p] << "\t" << lemmaBytes[p] << "\n";
+
+	auto &leaves = trie.leaves;
+	std::sort(leaves.begin(), leaves.end());
+	auto percentile = [&](const double &q) {
+		return leaves.empty() ? 0 : leaves[std::min(leaves.size() - 1, (size_t)(q * leaves.size()))];
+	};
+	out << "\nleaves\tmean\tp50\tp90\tp99\tmax\n";
+	out << leaves.size() << "\t" << (leaves.empty() ? 0.0 : (double)trie.analyses / leaves.size())
+		<< "\t" << percentile(0.5) << "\t" << percentile(0.9) << "\t" << percentile(0.99) << "\t" << (leaves.empty() ? 0 : leaves.back()) << "\n";
+
+	out << "\nprocess\tbytes\n";
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	auto mi = mallinfo2();
+#elif defined(__GLIBC__)
+	auto mi = mallinfo();
+#endif
+#if defined(__GLIBC__)
+	out << "malloc arena\t" << (size_t)mi.arena << "\n";
+	out << "malloc mmap\t" << (size_t)mi.hblkhd << "\n";
+	out << "malloc in use\t" << (size_t)mi.uordblks << "\n";
+	out << "malloc free\t" << (size_t)mi.fordblks << "\n";
+#endif
+	out << "rss\t" << procStatus("VmRSS") << "\n";
+	out << "peak rss\t" << procStatus("VmHWM") << "\n";
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Search.h"
+
+/*
+ * Compressed analysis lists for the trie. The trie is built with plain
+ * vectors of Nodes; packAnalyses then moves every list into one byte buffer
+ * and leaves each node with an offset into it (SearchMap::analyses).
+ *
+ * A list is split at changes of lemma into runs. Its tags go into a pattern,
+ * the run lengths and the tags of every run as indices into a tag dictionary
+ * (most frequent tag first, so common tags take one byte); patterns are
+ * shared, so every neuter plural of the second declension, say, points at
+ * the same nom/acc/voc pattern whichever lemma it belongs to. The leaf keeps
+ * the pattern's offset and one lemma id per run, delta coded against the
+ * run before, plus the weights when frequencies are loaded. Identical leaves
+ * are stored once. All numbers are LEB128 varints.
+ *
+ *	pattern	runs, then per run: count, count tag indices
+ *	leaf	pattern offset << 1 | weighted, then per run: zigzag lemma
+ *		delta, and with weighted set, a weight per analysis
+ */
+struct AnalysisTable
+{
+	// offset 0 of both buffers stands for none
+	std::vector<uint8_t> leaves;
+	std::vector<uint8_t> patterns;
+	std::vector<tag_t> tags;
+	size_t sets = 0;
+	size_t patternCount = 0;
+};
+
+inline void writeVarint(std::string *out, uint32_t v)
+{
+	while (v >= 0x80) {
+		out->push_back((char)(v | 0x80));
+		v >>= 7;
+	}
+	out->push_back((char)v);
+}
+
+inline const uint32_t readVarint(const uint8_t **p)
+{
+	uint32_t v = *(*p)++;
+	if (v < 0x80)
+		return v;
+	v &= 0x7F;
+	for (int shift = 7;; shift += 7) {
+		uint32_t b = *(*p)++;
+		v |= (b & 0x7F) << shift;
+		if (b < 0x80)
+			return v;
+	}
+}
+
+inline const uint32_t zigzag(const int32_t &v)
+{
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+inline const int32_t unzigzag(const uint32_t &v)
+{
+	return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+inline const bool hasAnalyses(const SearchMap *map)
+{
+	return map->analyses != 0 || !map->lemmas.empty();
+}
+
+inline void countTags(const SearchMap *map, std::unordered_map<tag_t, size_t> *counts)
+{
+	for (auto &n : map->lemmas)
+		(*counts)[n.tag]++;
+	for (auto &c : map->next)
+		countTags(&c, counts);
+}
+
+struct AnalysisPacker
+{
+	AnalysisTable *table;
+	std::unordered_map<tag_t, uint32_t> tagIndex;
+	std::unordered_map<std::string, uint32_t> patterns;
+	std::unordered_map<std::string, uint32_t> leaves;
+};
+
+inline const uint32_t intern(std::unordered_map<std::string, uint32_t> *seen, std::vector<uint8_t> *buffer, const std::string &bytes)
+{
+	auto it = seen->find(bytes);
+	if (it != seen->end())
+		return it->second;
+	uint32_t offset = buffer->size();
+	buffer->insert(buffer->end(), bytes.begin(), bytes.end());
+	seen->emplace(bytes, offset);
+	return offset;
+}
+
+inline void packNode(AnalysisPacker *packer, SearchMap *map)
+{
+	auto &lemmas = map->lemmas;
+	if (!lemmas.empty()) {
+		std::string pattern;
+		std::string runs;
+		std::string weights;
+		size_t runCount = 0;
+		lemma_id_t previous = 0;
+		bool weighted = false;
+		for (size_t i = 0; i < lemmas.size();) {
+			size_t j = i;
+			while (j < lemmas.size() && lemmas[j].lemma == lemmas[i].lemma)
+				j++;
+			writeVarint(&pattern, j - i);
+			for (size_t k = i; k < j; k++) {
+				writeVarint(&pattern, packer->tagIndex[lemmas[k].tag]);
+				writeVarint(&weights, lemmas[k].weight);
+				weighted = weighted || lemmas[k].weight != 0;
+			}
+			writeVarint(&runs, zigzag((int32_t)(lemmas[i].lemma - previous)));
+			previous = lemmas[i].lemma;
+			runCount++;
+			i = j;
+		}
+		std::string head;
+		writeVarint(&head, runCount);
+		size_t before = packer->patterns.size();
+		uint32_t p = intern(&packer->patterns, &packer->table->patterns, head + pattern);
+		packer->table->patternCount += packer->patterns.size() - before;
+		std::string leaf;
+		writeVarint(&leaf, p << 1 | weighted);
+		leaf += runs;
+		if (weighted)
+			leaf += weights;
+		before = packer->leaves.size();
+		map->analyses = intern(&packer->leaves, &packer->table->leaves, leaf);
+		packer->table->sets += packer->leaves.size() - before;
+		std::vector<Node>().swap(lemmas);
+	}
+	for (auto &c : map->next)
+		packNode(packer, &c);
+}
+
+// Call once the trie is complete and weighted; nodes no longer hold vectors
+// of analyses afterwards.
+inline const AnalysisTable packAnalyses(SearchMap *root)
+{
+	AnalysisTable table;
+	table.leaves.push_back(0);
+	table.patterns.push_back(0);
+	std::unordered_map<tag_t, size_t> counts;
+	countTags(root, &counts);
+	for (auto &c : counts)
+		table.tags.push_back(c.first);
+	std::sort(table.tags.begin(), table.tags.end(), [&](const tag_t &a, const tag_t &b) {
+		return counts[a] != counts[b] ? counts[a] > counts[b] : a < b;
+	});
+	AnalysisPacker packer;
+	packer.table = &table;
+	for (size_t i = 0; i < table.tags.size(); i++)
+		packer.tagIndex[table.tags[i]] = i;
+	packNode(&packer, root);
+	table.leaves.shrink_to_fit();
+	table.patterns.shrink_to_fit();
+	return table;
+}
+
+// Calls emit(const Node &) for every analysis of map in list order, whether
+// or not it has been packed.
+template<typename F>
+inline void forEachAnalysis(const AnalysisTable &table, const SearchMap *map, F &&emit)
+{
+	if (map->analyses == 0) {
+		for (auto &n : map->lemmas)
+			emit(n);
+		return;
+	}
+	const uint8_t *leaf = table.leaves.data() + map->analyses;
+	uint32_t head = readVarint(&leaf);
+	const uint8_t *pattern = table.patterns.data() + (head >> 1);
+	const bool weighted = head & 1;
+	uint32_t runs = readVarint(&pattern);
+	// weights follow the lemma deltas of every run
+	const uint8_t *weights = leaf;
+	for (uint32_t r = 0; r < runs; r++)
+		readVarint(&weights);
+	lemma_id_t lemma = 0;
+	for (uint32_t r = 0; r < runs; r++) {
+		lemma += unzigzag(readVarint(&leaf));
+		for (uint32_t count = readVarint(&pattern); count > 0; count--) {
+			Node n(lemma, table.tags[readVarint(&pattern)]);
+			if (weighted)
+				n.weight = readVarint(&weights);
+			emit(n);
+		}
+	}
+}
+
+inline const size_t analysisCount(const AnalysisTable &table, const SearchMap *map)
+{
+	size_t n = 0;
+	forEachAnalysis(table, map, [&](const Node &) { n++; });
+	return n;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/*
+ * Bounded lock-free queues for the batch pipeline (--pipeline). Both hold a
+ * power-of-two ring of slots. push blocks while the queue is full, which is
+ * what holds a fast stage back to the pace of a slow one, and pop blocks
+ * while it is empty until the producers close the queue. Blocked threads
+ * spin briefly, then yield, then sleep in short steps so that an idle stage
+ * does not hold on to a core.
+ *
+ * Each queue keeps the time its producers spent blocked on a full queue and
+ * its consumers on an empty one, and samples its occupancy at every push,
+ * which is what tells the bottleneck stage apart: the queue in front of it
+ * runs full, the one behind it runs empty.
+ */
+
+struct QueueStats
+{
+	std::atomic<uint64_t> pushes{ 0 };
+	std::atomic<uint64_t> occupancy{ 0 };
+	std::atomic<uint64_t> fullNanos{ 0 };
+	std::atomic<uint64_t> emptyNanos{ 0 };
+};
+
+// Waits until ready() holds; returns the nanoseconds waited.
+template<typename F>
+inline const uint64_t waitUntil(F &&ready)
+{
+	if (ready())
+		return 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int spin = 0; !ready(); spin++) {
+		if (spin >= 1024)
+			std::this_thread::sleep_for(std::chrono::microseconds(20));
+		else if (spin >= 64)
+			std::this_thread::yield();
+	}
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline const size_t ringSize(const size_t &capacity)
+{
+	size_t n = 1;
+	while (n < capacity)
+		n <<= 1;
+	return n;
+}
+
+// One producer thread, one consumer thread.
+template<typename T>
+struct SpscQueue
+{
+	std::vector<T> slots;
+	size_t mask;
+	alignas(64) std::atomic<size_t> head{ 0 };
+	alignas(64) std::atomic<size_t> tail{ 0 };
+	std::atomic<bool> closed{ false };
+	QueueStats stats;
+
+	SpscQueue(const size_t &capacity) : slots(ringSize(capacity)), mask(ringSize(capacity) - 1)
+	{}
+
+	void push(T &&item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		stats.fullNanos += waitUntil([&] { return t - head.load(std::memory_order_acquire) <= mask; });
+		stats.pushes++;
+		stats.occupancy += t - head.load(std::memory_order_relaxed);
+		slots[t & mask] = std::move(item);
+		tail.store(t + 1, std::memory_order_release);
+	}
+
+	// false once the queue is closed and drained.
+	const bool pop(T *item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		stats.emptyNanos += waitUntil([&] { return tail.load(std::memory_order_acquire) != h || closed.load(std::memory_order_acquire); });
+		if (tail.load(std::memory_order_acquire) == h)
+			return false;
+		*item = std::move(slots[h & mask]);
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	void close()
+	{
+		closed.store(true, std::memory_order_release);
+	}
+};
+
+// Any number of producers and consumers, after Vyukov's bounded queue: every
+// slot carries a sequence number telling whose turn it is.
+template<typename T>
+struct MpmcQueue
+{
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	size_t mask;
+	alignas(64) std::atomic<size_t> head{ 0 };
+	alignas(64) std::atomic<size_t> tail{ 0 };
+	std::atomic<bool> closed{ false };
+	QueueStats stats;
+
+	MpmcQueue(const size_t &capacity) : slots(new Slot[ringSize(capacity)]), mask(ringSize(capacity) - 1)
+	{
+		for (size_t i = 0; i <= mask; i++)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	const bool tryPush(T *item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		while (true) {
+			auto &slot = slots[t & mask];
+			size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if (sequence == t) {
+				if (tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed)) {
+					stats.pushes++;
+					stats.occupancy += t - std::min(t, head.load(std::memory_order_relaxed));
+					slot.item = std::move(*item);
+					slot.sequence.store(t + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (sequence < t) {
+				return false;
+			} else {
+				t = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	const bool tryPop(T *item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		while (true) {
+			auto &slot = slots[h & mask];
+			size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if (sequence == h + 1) {
+				if (head.compare_exchange_weak(h, h + 1, std::memory_order_relaxed)) {
+					*item = std::move(slot.item);
+					slot.sequence.store(h + mask + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (sequence < h + 1) {
+				return false;
+			} else {
+				h = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void push(T &&item)
+	{
+		stats.fullNanos += waitUntil([&] { return tryPush(&item); });
+	}
+
+	// false once the queue is closed and drained.
+	const bool pop(T *item)
+	{
+		bool popped = false;
+		stats.emptyNanos += waitUntil([&] {
+			if (tryPop(item))
+				return popped = true;
+			// a push completed before close is visible to this last try
+			return closed.load(std::memory_order_acquire) && (popped = tryPop(item), true);
+		});
+		return popped;
+	}
+
+	void close()
+	{
+		closed.store(true, std::memory_order_release);
+	}
+};
@@ -1,10 +1,20 @@
 #pragma once
 
 #include <string>
-#include <map>
+#include <algorithm>
 #include <vector>
+#include <cstdint>
+
+#include "Form.h"
+#include "Gloss.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 typedef std::string series_t;
+typedef uint16_t tag_t;
+typedef uint32_t lemma_id_t;
 
 enum Gender
 {
@@ -226,14 +236,34 @@ struct Conjugation
 	CTuple sub_impf;
 };
 
+/*
+ * Paradigms are parsed once into these registries and never change after
+ * loading; lemmas refer to them by id, so copying or comparing a lemma never
+ * touches paradigm strings. Conjugation 0 is the empty one ("*" in the data).
+ */
+typedef uint16_t paradigm_id_t;
+
+extern std::vector<Declension> DECLENSIONS;
+extern std::vector<Conjugation> CONJUGATIONS;
+
+inline const Declension &declension(const paradigm_id_t &id)
+{
+	return DECLENSIONS[id];
+}
+
+inline const Conjugation &conjugation(const paradigm_id_t &id)
+{
+	return CONJUGATIONS[id];
+}
+
 struct NounLemma
 {
 	series_t lemma = "*";
 	series_t genov = "*";
 	series_t stem = "*";
 	Gender gender;
-	Declension decl;
-	std::string meaning;
+	paradigm_id_t decl;
+	Gloss meaning;
 };
 
 struct AdjLemma
@@ -244,10 +274,10 @@ struct AdjLemma
 	series_t nlemma = "*";
 	series_t stem = "*";
 	series_t suffix = "*";
-	Declension mas;
-	Declension fem;
-	Declension neu;
-	std::string meaning;
+	paradigm_id_t mas;
+	paradigm_id_t fem;
+	paradigm_id_t neu;
+	Gloss meaning;
 };
 
 struct VerbLemma
@@ -259,10 +289,10 @@ struct VerbLemma
 	series_t ger_stem = "*";
 	series_t prs_act_part_stem = "*";
 	series_t prs_fut_part_stem = "*";
-	Conjugation active_simple;
-	Conjugation active_perfect;
-	Conjugation passive_simple;
-	std::string meaning;
+	paradigm_id_t active_simple;
+	paradigm_id_t active_perfect;
+	paradigm_id_t passive_simple;
+	Gloss meaning;
 };
 
 struct NounQuery
@@ -281,30 +311,98 @@ struct VerbQuery
 	ConjugationSchema c;
 };
 
+// One analysis of a form: the lemma's id in the Lexicon, its packed
+// features (see Tag.h) and its frequency weight (see Frequency.h).
 struct Node
 {
-	NodeType type;
-	union
-	{
-		NounQuery nounQuery;
-		AdjQuery adjQuery;
-		VerbQuery verbQuery;
-	};
-	NounLemma nounLemma;
-	AdjLemma adjLemma;
-	VerbLemma verbLemma;
-
-	Node(const NounLemma &, const NounQuery &);
-	Node(const AdjLemma &, const AdjQuery &);
-	Node(const VerbLemma &, const VerbQuery &);
+	tag_t tag;
+	uint16_t weight = 0;
+	lemma_id_t lemma;
+
+	Node(const lemma_id_t &, const tag_t &);
+};
+
+struct Analysis
+{
+	Node node;
+	uint8_t enclitic;
 };
 
+/*
+ * A trie node. The first 16 child labels are kept sorted in a zero-padded
+ * array inside the node and any further ones in a spill string padded the
+ * same way; the children themselves sit in a parallel array. A node with up
+ * to 16 children (nearly all of them) is searched with one 16-byte compare.
+ */
 struct SearchMap
 {
-	std::map<char, SearchMap> next;
+	char labels[16] = { 0 };
+	std::string spill;
+	std::vector<SearchMap> next;
 	std::vector<Node> lemmas;
+	// union of the feature sets of lemmas (see Filter.h)
+	uint64_t features = 0;
+	// where lemmas went once packed (see Packed.h), 0 before
+	uint32_t analyses = 0;
 };
 
+inline const char childLabel(const SearchMap *map, const size_t &i)
+{
+	return i < 16 ? map->labels[i] : map->spill[i - 16];
+}
+
+// Index of c among the n labels of one 16-byte block, or -1. Unused label
+// bytes are zero, and are masked off since c may be zero too.
+inline const int findLabel(const char *block, const size_t &n, const char &c)
+{
+	unsigned live = n >= 16 ? 0xFFFFu : (1u << n) - 1;
+#if defined(__SSE2__)
+	unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)block), _mm_set1_epi8(c))) & live;
+	return mask ? __builtin_ctz(mask) : -1;
+#else
+	for (int i = 0; live >> i; i++) {
+		if (block[i] == c)
+			return i;
+	}
+	return -1;
+#endif
+}
+
+inline const SearchMap *findChild(const SearchMap *map, const char &c)
+{
+	const size_t n = map->next.size();
+	int i = findLabel(map->labels, n, c);
+	if (i >= 0)
+		return &map->next[i];
+	for (size_t b = 16; b < n; b += 16) {
+		i = findLabel(map->spill.data() + b - 16, n - b, c);
+		if (i >= 0)
+			return &map->next[b + i];
+	}
+	return NULL;
+}
+
+inline SearchMap *addChild(SearchMap *map, const char &c)
+{
+	const size_t n = map->next.size();
+	std::string labels(map->labels, std::min<size_t>(n, 16));
+	if (n > 16)
+		labels.append(map->spill, 0, n - 16);
+	size_t i = std::lower_bound(labels.begin(), labels.end(), c) - labels.begin();
+	if (i < n && labels[i] == c)
+		return &map->next[i];
+	labels.insert(labels.begin() + i, c);
+	map->next.insert(map->next.begin() + i, SearchMap());
+
+	std::fill(map->labels, map->labels + 16, 0);
+	std::copy(labels.begin(), labels.begin() + std::min<size_t>(labels.size(), 16), map->labels);
+	if (labels.size() > 16) {
+		map->spill = labels.substr(16);
+		map->spill.resize((map->spill.size() + 15) / 16 * 16, 0);
+	}
+	return &map->next[i];
+}
+
 inline const bool operator==(const DPair &a, const DPair &b)
 {
 	if (a.sg != b.sg)
@@ -517,32 +615,19 @@ inline const bool operator!=(const VerbQuery &a, const VerbQuery &b)
 
 inline const bool operator==(const Node &a, const Node &b)
 {
-	if (a.type != b.type)
-		return false;
-	switch (a.type) {
-		case NOUN:
-			if (a.nounQuery != b.nounQuery)
-				return false;
-			if (a.nounLemma != b.nounLemma)
-				return false;
-			break;
-		case ADJECTIVE:
-			if (a.adjQuery != b.adjQuery)
-				return false;
-			if (a.adjLemma != b.adjLemma)
-				return false;
-			break;
-		case VERB:
-			if (a.verbQuery != b.verbQuery)
-				return false;
-			if (a.verbLemma != b.verbLemma)
-				return false;
-			break;
-	}
-	return true;
+	return a.tag == b.tag && a.lemma == b.lemma;
+}
+
+inline const uint64_t nodeKey(const Node &n)
+{
+	return ((uint64_t)n.lemma << 16) | n.tag;
 }
 
 inline const bool operator!=(const Node &a, const Node &b)
 {
 	return !(a == b);
-}
\ No newline at end of file
+}
+
+const form_t decline(const NounLemma &, const Inflection &);
+const form_t decline(const AdjLemma &, const Inflection &, const Gender &);
+const form_t conjugate(const VerbLemma &, const ConjugationSchema &);
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "Bloom.h"
+#include "Packed.h"
+#include "Search.h"
+
+/*
+ * Sharded lookups (--shard, --shards, --route). The form space is split by a
+ * hash of each form's folded spelling (Fold.h): shard i of n holds the forms
+ * whose folded key falls to i, and every lemma, so lemma ids agree between
+ * processes. A router holding no forms sends each token to the shards owning
+ * the folded keys it may be read under, the token itself and the host left by
+ * each enclitic it may end in, and merges their answers.
+ *
+ * Processes talk over Unix stream sockets in length-prefixed frames of LEB128
+ * varints (Packed.h). On connecting, a shard sends a hello and the router a
+ * setup:
+ *
+ *	hello		shard, shards, lemma count
+ *	setup		the router's --filter spec as is, empty for none; the
+ *			shard answers with an error message, empty when it
+ *			applies the filter
+ *	request		per token: length, lowercased bytes
+ *	response	per token: candidate count, then per candidate: length,
+ *			spelling, a byte set when it is a form as it stands
+ *			(filter aside), analysis count, then per analysis:
+ *			lemma, tag, weight, enclitic
+ *
+ * Only candidates with analyses or that are forms are sent, each with its
+ * analyses in the order analyzeSequence gives them. POSIX only; sockets fail to open
+ * elsewhere.
+ */
+
+// Which of shards a folded key belongs to, from the top 32 bits of its hash.
+// The Bloom filter's block index is the whole hash modulo the block count and
+// so depends on these bits too, but the low 32 bits, which the shard leaves
+// free, are enough on their own to spread a shard's keys over its blocks.
+inline const uint32_t shardOf(const std::string_view &key, const uint32_t &shards)
+{
+	return (uint32_t)(((hashSeries(key) >> 32) * shards) >> 32);
+}
+
+// Parses "i/n"; false unless i < n.
+inline const bool parseShard(const std::string &spec, uint32_t *shard, uint32_t *shards)
+{
+	auto slash = spec.find('/');
+	if (slash == std::string::npos)
+		return false;
+	try {
+		*shard = std::stoul(spec.substr(0, slash));
+		*shards = std::stoul(spec.substr(slash + 1));
+	} catch (...) {
+		return false;
+	}
+	return *shard < *shards;
+}
+
+inline void writeAnalysis(std::string *out, const Analysis &a)
+{
+	writeVarint(out, a.node.lemma);
+	writeVarint(out, a.node.tag);
+	writeVarint(out, a.node.weight);
+	out->push_back((char)a.enclitic);
+}
+
+// The readers below parse a frame ending at end; each returns false, having
+// moved *p no further than end, when the frame stops short of what it reads.
+inline const bool readVarint(const uint8_t **p, const uint8_t *end, uint32_t *v)
+{
+	*v = 0;
+	for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+		uint32_t b = *(*p)++;
+		*v |= (b & 0x7F) << shift;
+		if (b < 0x80)
+			return true;
+	}
+	return false;
+}
+
+inline const bool readByte(const uint8_t **p, const uint8_t *end, uint8_t *v)
+{
+	if (*p == end)
+		return false;
+	*v = *(*p)++;
+	return true;
+}
+
+inline const bool readAnalysis(const uint8_t **p, const uint8_t *end, Analysis *a)
+{
+	uint32_t lemma, tag, weight;
+	uint8_t enclitic;
+	if (!readVarint(p, end, &lemma) || !readVarint(p, end, &tag) || !readVarint(p, end, &weight) || !readByte(p, end, &enclitic))
+		return false;
+	Node n(lemma, (tag_t)tag);
+	n.weight = weight;
+	*a = { n, enclitic };
+	return true;
+}
+
+inline const bool readBytes(const uint8_t **p, const uint8_t *end, std::string_view *s)
+{
+	uint32_t length;
+	if (!readVarint(p, end, &length) || length > (size_t)(end - *p))
+		return false;
+	*s = std::string_view((const char *)*p, length);
+	*p += length;
+	return true;
+}
+
+#ifndef _WIN32
+inline const bool sendAll(const int &fd, const char *data, size_t size)
+{
+	while (size > 0) {
+		auto n = send(fd, data, size, MSG_NOSIGNAL);
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+inline const bool recvAll(const int &fd, char *data, size_t size)
+{
+	while (size > 0) {
+		auto n = recv(fd, data, size, 0);
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+inline const sockaddr_un unixAddress(const std::string &path)
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+	return address;
+}
+#endif
+
+inline const bool writeFrame(const int &fd, const std::string &payload)
+{
+#ifdef _WIN32
+	return false;
+#else
+	uint8_t length[4];
+	for (int i = 0; i < 4; i++)
+		length[i] = (uint8_t)(payload.size() >> (8 * i));
+	return sendAll(fd, (const char *)length, 4) && sendAll(fd, payload.data(), payload.size());
+#endif
+}
+
+// false at the end of the stream.
+inline const bool readFrame(const int &fd, std::string *payload)
+{
+#ifdef _WIN32
+	return false;
+#else
+	uint8_t length[4];
+	if (!recvAll(fd, (char *)length, 4))
+		return false;
+	payload->resize(length[0] | length[1] << 8 | length[2] << 16 | (uint32_t)length[3] << 24);
+	return recvAll(fd, &(*payload)[0], payload->size());
+#endif
+}
+
+// A listening socket at path, replacing any stale one; -1 on failure.
+inline const int listenUnix(const std::string &path)
+{
+#ifdef _WIN32
+	return -1;
+#else
+	auto address = unixAddress(path);
+	if (path.size() >= sizeof(address.sun_path))
+		return -1;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	unlink(path.c_str());
+	if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 4) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+#endif
+}
+
+// -1 when nothing is listening at path (yet).
+inline const int connectUnix(const std::string &path)
+{
+#ifdef _WIN32
+	return -1;
+#else
+	auto address = unixAddress(path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+#endif
+}
+
+// Waits up to milliseconds for a connection on listener; -1 if none came.
+inline const int acceptUnix(const int &listener, const int &milliseconds)
+{
+#ifdef _WIN32
+	return -1;
+#else
+	pollfd p = { listener, POLLIN, 0 };
+	if (poll(&p, 1, milliseconds) <= 0)
+		return -1;
+	return accept(listener, NULL, NULL);
+#endif
+}
+
+inline void closeSocket(const int &fd)
+{
+#ifndef _WIN32
+	if (fd >= 0)
+		close(fd);
+#endif
+}
+
+inline void removeSocket(const std::string &path)
+{
+#ifndef _WIN32
+	unlink(path.c_str());
+#endif
+}
+
+// Removes the directory holding the socket at path, once it is empty.
+inline void removeSocketDirectory(const std::string &path)
+{
+#ifndef _WIN32
+	auto slash = path.rfind('/');
+	if (slash != std::string::npos && slash != 0)
+		rmdir(path.substr(0, slash).c_str());
+#endif
+}
+
+/*
+ * Local shard processes for --shards, forked before the lexicon is read so
+ * that each builds only its own share of the form trie; every shard still
+ * loads all the lemmas. A private directory holds their sockets.
+ */
+struct ShardProcesses
+{
+	std::string directory;
+	std::vector<int> pids;
+};
+
+inline const std::string shardSocket(const ShardProcesses &processes, const uint32_t &shard)
+{
+	return processes.directory + "/shard-" + std::to_string(shard);
+}
+
+// Returns the shard the calling process is to serve: shards in the parent,
+// which should route, and the child's own index in each child. The parent
+// holds fewer than shards pids when not all processes could be made.
+inline const uint32_t forkShards(ShardProcesses *processes, const uint32_t &shards)
+{
+#ifndef _WIN32
+	char directory[] = "/tmp/lemma-shards-XXXXXX";
+	if (mkdtemp(directory) == NULL)
+		return shards;
+	processes->directory = directory;
+	for (uint32_t i = 0; i < shards; i++) {
+		int pid = fork();
+		if (pid == 0) {
+			processes->pids.clear();
+			return i;
+		}
+		if (pid < 0)
+			break;
+		processes->pids.push_back(pid);
+	}
+#endif
+	return shards;
+}
+
+// Whether every shard process is still running.
+inline const bool shardsRunning(const ShardProcesses &processes)
+{
+#ifndef _WIN32
+	for (auto &pid : processes.pids) {
+		if (waitpid(pid, NULL, WNOHANG) != 0)
+			return false;
+	}
+#endif
+	return true;
+}
+
+// Waits for the shards to leave, once the router has closed their sockets.
+inline void reapShards(ShardProcesses *processes)
+{
+#ifndef _WIN32
+	for (auto &pid : processes->pids)
+		waitpid(pid, NULL, 0);
+	processes->pids.clear();
+	if (!processes->directory.empty())
+		rmdir(processes->directory.c_str());
+#endif
+}
+
+// Ends the shards at once, as when the router cannot go on.
+inline void stopShards(ShardProcesses *processes)
+{
+#ifndef _WIN32
+	for (auto &pid : processes->pids)
+		kill(pid, SIGTERM);
+	for (uint32_t i = 0; i < processes->pids.size(); i++)
+		removeSocket(shardSocket(*processes, i));
+#endif
+	reapShards(processes);
+}
+
+// Whether the process that spawned this one has gone; never for parent 0.
+inline const bool orphaned(const int &parent)
+{
+#ifdef _WIN32
+	return false;
+#else
+	return parent != 0 && getppid() != parent;
+#endif
+}
+
+inline const int processId()
+{
+#ifdef _WIN32
+	return 0;
+#else
+	return getpid();
+#endif
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Search.h"
+
+/*
+ * Reverse index of full forms for "every form ending in X" queries
+ * (--suffix). Every form is stored reversed in one pool, NUL terminated, and
+ * the entries are sorted by their reversed spelling, so the forms ending in
+ * a suffix are one contiguous range, found with two binary searches; a query
+ * costs log n plus the number of matches. Entries come out ordered by their
+ * endings read backwards, which is rhyme order.
+ */
+struct SuffixIndex
+{
+	std::string pool;
+	std::vector<uint32_t> entries;
+};
+
+inline const std::string_view suffixEntry(const SuffixIndex &index, const uint32_t &offset)
+{
+	return std::string_view(index.pool.data() + offset);
+}
+
+// forms need not be unique.
+inline const SuffixIndex buildSuffixIndex(std::vector<series_t> forms)
+{
+	for (auto &f : forms)
+		std::reverse(f.begin(), f.end());
+	std::sort(forms.begin(), forms.end());
+	forms.erase(std::unique(forms.begin(), forms.end()), forms.end());
+	SuffixIndex index;
+	for (auto &f : forms) {
+		index.entries.push_back(index.pool.size());
+		index.pool += f;
+		index.pool.push_back('\0');
+	}
+	return index;
+}
+
+// Calls emit(const series_t &) with every form ending in suffix.
+template<typename F>
+void matchSuffix(const SuffixIndex &index, const std::string_view &suffix, F &&emit)
+{
+	series_t key(suffix.rbegin(), suffix.rend());
+	auto begin = std::lower_bound(index.entries.begin(), index.entries.end(), key, [&](const uint32_t &e, const series_t &k) {
+		return suffixEntry(index, e) < k;
+	});
+	auto end = std::upper_bound(begin, index.entries.end(), key, [&](const series_t &k, const uint32_t &e) {
+		return k < suffixEntry(index, e).substr(0, k.size());
+	});
+	series_t form;
+	for (auto it = begin; it != end; it++) {
+		auto reversed = suffixEntry(index, *it);
+		form.assign(reversed.rbegin(), reversed.rend());
+		emit(form);
+	}
+}
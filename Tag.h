@@ -0,0 +1,289 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "Search.h"
+
+/*
+ * Morphological features of one analysis packed into 16 bits:
+ *
+ *	bits  0-1	part of speech (NodeType)
+ *	bit   2		number (0 singular, 1 plural)
+ *	bits  3-5	case (Inflection / 2)
+ *	bits  6-7	gender (Gender) for nominals, person (1-3, 0 for infinitives) for verbs
+ *	bits  8-9	degree (AType)
+ *	bits 10-11	mood (TagMood)
+ *	bit  12		voice (0 active, 1 passive)
+ *	bits 13-15	tense (TagTense)
+ *
+ * Fields that do not apply to a part of speech are zero, so two analyses
+ * carry the same features exactly when their tags are equal. tag_t itself
+ * is declared in Search.h.
+ */
+
+enum TagMood
+{
+	M_INF,
+	M_IMP,
+	M_IND,
+	M_SUB
+};
+
+enum TagTense
+{
+	T_PRE,
+	T_IMP,
+	T_FUT,
+	T_PRF,
+	T_PLU,
+	T_FPR
+};
+
+const int TAG_POS_SHIFT = 0;
+const int TAG_NUMBER_SHIFT = 2;
+const int TAG_CASE_SHIFT = 3;
+const int TAG_GENDER_SHIFT = 6;
+const int TAG_PERSON_SHIFT = 6;
+const int TAG_DEGREE_SHIFT = 8;
+const int TAG_MOOD_SHIFT = 10;
+const int TAG_VOICE_SHIFT = 12;
+const int TAG_TENSE_SHIFT = 13;
+
+const tag_t TAG_POS = 0x3 << TAG_POS_SHIFT;
+const tag_t TAG_NUMBER = 0x1 << TAG_NUMBER_SHIFT;
+const tag_t TAG_CASE = 0x7 << TAG_CASE_SHIFT;
+const tag_t TAG_GENDER = 0x3 << TAG_GENDER_SHIFT;
+const tag_t TAG_PERSON = 0x3 << TAG_PERSON_SHIFT;
+const tag_t TAG_DEGREE = 0x3 << TAG_DEGREE_SHIFT;
+const tag_t TAG_MOOD = 0x3 << TAG_MOOD_SHIFT;
+const tag_t TAG_VOICE = 0x1 << TAG_VOICE_SHIFT;
+const tag_t TAG_TENSE = 0x7 << TAG_TENSE_SHIFT;
+
+const int CASE_COUNT = 7;
+const int SCHEMA_COUNT = 104;
+
+inline const NodeType tagType(const tag_t &t)
+{
+	return (NodeType)((t & TAG_POS) >> TAG_POS_SHIFT);
+}
+
+inline const int tagNumber(const tag_t &t)
+{
+	return (t & TAG_NUMBER) >> TAG_NUMBER_SHIFT;
+}
+
+inline const int tagCase(const tag_t &t)
+{
+	return (t & TAG_CASE) >> TAG_CASE_SHIFT;
+}
+
+inline const Inflection tagInflection(const tag_t &t)
+{
+	return (Inflection)(tagCase(t) * 2 + tagNumber(t));
+}
+
+inline const Gender tagGender(const tag_t &t)
+{
+	return (Gender)((t & TAG_GENDER) >> TAG_GENDER_SHIFT);
+}
+
+inline const int tagPerson(const tag_t &t)
+{
+	return (t & TAG_PERSON) >> TAG_PERSON_SHIFT;
+}
+
+inline const AType tagDegree(const tag_t &t)
+{
+	return (AType)((t & TAG_DEGREE) >> TAG_DEGREE_SHIFT);
+}
+
+inline const TagMood tagMood(const tag_t &t)
+{
+	return (TagMood)((t & TAG_MOOD) >> TAG_MOOD_SHIFT);
+}
+
+inline const int tagVoice(const tag_t &t)
+{
+	return (t & TAG_VOICE) >> TAG_VOICE_SHIFT;
+}
+
+inline const TagTense tagTense(const tag_t &t)
+{
+	return (TagTense)((t & TAG_TENSE) >> TAG_TENSE_SHIFT);
+}
+
+inline const tag_t nominalTag(const NodeType &type, const Inflection &i)
+{
+	return (type << TAG_POS_SHIFT) | ((i % 2) << TAG_NUMBER_SHIFT) | ((i / 2) << TAG_CASE_SHIFT);
+}
+
+inline const tag_t makeTag(const NounQuery &nq)
+{
+	return nominalTag(NOUN, nq.i);
+}
+
+inline const tag_t makeTag(const AdjQuery &aq, const AType &degree = A_POS)
+{
+	return nominalTag(ADJECTIVE, aq.i) | (aq.g << TAG_GENDER_SHIFT) | (degree << TAG_DEGREE_SHIFT);
+}
+
+inline const tag_t verbTag(const TagMood &mood, const int &voice, const TagTense &tense, const int &person, const int &number)
+{
+	return (VERB << TAG_POS_SHIFT)
+		| (number << TAG_NUMBER_SHIFT)
+		| (person << TAG_PERSON_SHIFT)
+		| (mood << TAG_MOOD_SHIFT)
+		| (voice << TAG_VOICE_SHIFT)
+		| (tense << TAG_TENSE_SHIFT);
+}
+
+// Follows the layout of ConjugationSchema: infinitives, imperatives, then
+// runs of six persons (1sg..3pl) per mood, voice and tense.
+inline const std::array<tag_t, SCHEMA_COUNT> buildSchemaTags()
+{
+	std::array<tag_t, SCHEMA_COUNT> tags = {};
+	tags[INF_ACT_PRE] = verbTag(M_INF, 0, T_PRE, 0, 0);
+	tags[INF_ACT_PRF] = verbTag(M_INF, 0, T_PRF, 0, 0);
+	tags[INF_PAS_PRE] = verbTag(M_INF, 1, T_PRE, 0, 0);
+
+	tags[IMP_ACT_PRE_2SG] = verbTag(M_IMP, 0, T_PRE, 2, 0);
+	tags[IMP_ACT_PRE_2PL] = verbTag(M_IMP, 0, T_PRE, 2, 1);
+	tags[IMP_ACT_FUT_2SG] = verbTag(M_IMP, 0, T_FUT, 2, 0);
+	tags[IMP_ACT_FUT_3SG] = verbTag(M_IMP, 0, T_FUT, 3, 0);
+	tags[IMP_ACT_FUT_2PL] = verbTag(M_IMP, 0, T_FUT, 2, 1);
+	tags[IMP_ACT_FUT_3PL] = verbTag(M_IMP, 0, T_FUT, 3, 1);
+
+	tags[IMP_PAS_PRE_2SG] = verbTag(M_IMP, 1, T_PRE, 2, 0);
+	tags[IMP_PAS_PRE_2PL] = verbTag(M_IMP, 1, T_PRE, 2, 1);
+	tags[IMP_PAS_FUT_2SG] = verbTag(M_IMP, 1, T_FUT, 2, 0);
+	tags[IMP_PAS_FUT_3SG] = verbTag(M_IMP, 1, T_FUT, 3, 0);
+	tags[IMP_PAS_FUT_3PL] = verbTag(M_IMP, 1, T_FUT, 3, 1);
+
+	struct Run
+	{
+		ConjugationSchema first;
+		TagMood mood;
+		int voice;
+		TagTense tense;
+	};
+	const Run runs[] = {
+		{ IND_ACT_SIM_PRE_1SG, M_IND, 0, T_PRE },
+		{ IND_ACT_SIM_IMP_1SG, M_IND, 0, T_IMP },
+		{ IND_ACT_SIM_FUT_1SG, M_IND, 0, T_FUT },
+		{ IND_ACT_PRF_PRE_1SG, M_IND, 0, T_PRF },
+		{ IND_ACT_PRF_IMP_1SG, M_IND, 0, T_PLU },
+		{ IND_ACT_PRF_FUT_1SG, M_IND, 0, T_FPR },
+		{ IND_PAS_SIM_PRE_1SG, M_IND, 1, T_PRE },
+		{ IND_PAS_SIM_IMP_1SG, M_IND, 1, T_IMP },
+		{ IND_PAS_SIM_FUT_1SG, M_IND, 1, T_FUT },
+		{ SUB_ACT_SIM_PRE_1SG, M_SUB, 0, T_PRE },
+		{ SUB_ACT_SIM_IMP_1SG, M_SUB, 0, T_IMP },
+		{ SUB_ACT_PRF_PRE_1SG, M_SUB, 0, T_PRF },
+		{ SUB_ACT_PRF_IMP_1SG, M_SUB, 0, T_PLU },
+		{ SUB_PAS_SIM_PRE_1SG, M_SUB, 1, T_PRE },
+		{ SUB_PAS_SIM_IMP_1SG, M_SUB, 1, T_IMP }
+	};
+	for (auto &r : runs) {
+		for (int p = 0; p < 6; p++)
+			tags[r.first + p] = verbTag(r.mood, r.voice, r.tense, p % 3 + 1, p / 3);
+	}
+	return tags;
+}
+
+inline const std::array<tag_t, SCHEMA_COUNT> &schemaTags()
+{
+	static const auto tags = buildSchemaTags();
+	return tags;
+}
+
+inline const tag_t makeTag(const VerbQuery &vq)
+{
+	return schemaTags()[vq.c];
+}
+
+inline const ConjugationSchema tagSchema(const tag_t &t)
+{
+	static const auto schemas = [] {
+		std::array<uint8_t, 1 << 16> s = {};
+		for (int c = 0; c < SCHEMA_COUNT; c++)
+			s[schemaTags()[c]] = c;
+		return s;
+	}();
+	return (ConjugationSchema)schemas[t];
+}
+
+inline const NounQuery nounQuery(const tag_t &t)
+{
+	return { tagInflection(t) };
+}
+
+inline const AdjQuery adjQuery(const tag_t &t)
+{
+	return { tagInflection(t), tagGender(t) };
+}
+
+inline const VerbQuery verbQuery(const tag_t &t)
+{
+	return { tagSchema(t) };
+}
+
+/*
+ * Short textual form of a tag, fields separated by dots:
+ *	N.<case>.<number>
+ *	A.<case>.<number>.<gender>.<degree>
+ *	V.<mood>.<voice>.<tense>[.<person>.<number>]
+ * e.g. N.ABL.SG, A.NOM.PL.F.POS, V.IND.ACT.PRE.3.SG, V.INF.PAS.PRE.
+ */
+inline const std::string tagName(const tag_t &t)
+{
+	static const char *CASES[] = { "NOM", "GEN", "DAT", "ACC", "ABL", "VOC", "LOC" };
+	static const char *NUMBERS[] = { "SG", "PL" };
+	static const char *GENDERS[] = { "M", "N", "F" };
+	static const char *DEGREES[] = { "POS", "COMP", "SUPR" };
+	static const char *MOODS[] = { "INF", "IMP", "IND", "SUB" };
+	static const char *VOICES[] = { "ACT", "PAS" };
+	static const char *TENSES[] = { "PRE", "IMP", "FUT", "PRF", "PLU", "FPR" };
+	switch (tagType(t)) {
+		case NOUN:
+			return std::string("N.") + CASES[tagCase(t)] + "." + NUMBERS[tagNumber(t)];
+		case ADJECTIVE:
+			return std::string("A.") + CASES[tagCase(t)] + "." + NUMBERS[tagNumber(t)] + "." + GENDERS[tagGender(t)] + "." + DEGREES[tagDegree(t)];
+		case VERB: {
+			std::string s = std::string("V.") + MOODS[tagMood(t)] + "." + VOICES[tagVoice(t)] + "." + TENSES[tagTense(t)];
+			if (tagPerson(t) != 0)
+				s += "." + std::to_string(tagPerson(t)) + "." + NUMBERS[tagNumber(t)];
+			return s;
+		}
+		default:
+			return "<error>";
+	}
+}
+
+// Parses the output of tagName; returns false for anything else.
+inline const bool parseTag(const std::string &s, tag_t *t)
+{
+	static const auto names = [] {
+		std::unordered_map<std::string, tag_t> m;
+		for (int i = 0; i < 14; i++) {
+			tag_t n = makeTag(NounQuery{ (Inflection)i });
+			m[tagName(n)] = n;
+			for (int g = 0; g < 3; g++) {
+				for (int d = 0; d < 3; d++) {
+					tag_t a = makeTag(AdjQuery{ (Inflection)i, (Gender)g }, (AType)d);
+					m[tagName(a)] = a;
+				}
+			}
+		}
+		for (int c = 0; c < SCHEMA_COUNT; c++)
+			m[tagName(schemaTags()[c])] = schemaTags()[c];
+		return m;
+	}();
+	auto it = names.find(s);
+	if (it == names.end())
+		return false;
+	*t = it->second;
+	return true;
+}
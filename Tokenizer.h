@@ -0,0 +1,263 @@
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Splits running text into word tokens. Word characters are ASCII letters,
+ * the apostrophe and its curly forms ‘ and ’, U+00C0 to U+07FF save × and ÷
+ * (the Latin-1 and Latin Extended letters, macron vowels among them,
+ * combining marks, Greek and Cyrillic) and U+1000 to U+1FFF (Latin Extended
+ * Additional and polytonic Greek). Everything else separates tokens: ASCII
+ * whitespace, digits and punctuation as well as « », dashes, curly double
+ * quotes and the rest of U+2000 to U+206F. Text is classified 64 bytes at a
+ * time into a bitmask (AVX2, SSE2 or scalar) and token boundaries are read
+ * off the mask's edges.
+ */
+
+inline const bool isWordAscii(const unsigned char &c)
+{
+	return (unsigned char)((c | 0x20) - 'a') < 26 || c == '\'';
+}
+
+// An ASCII byte outside words. Text split after one tokenizes as the whole
+// would, since no character or word runs across it.
+inline const bool isBreakByte(const unsigned char &c)
+{
+	return c < 0x80 && !isWordAscii(c);
+}
+
+// Whether text[i] is part of a word character. A byte of a multi-byte
+// character is classified with the rest of it, up to two bytes either side;
+// bytes past either end of text count as absent.
+inline const bool isWordByte(const std::string_view &text, const size_t &i)
+{
+	unsigned char c = text[i];
+	if (c < 0x80)
+		return isWordAscii(c);
+	size_t s = i;
+	while (s > 0 && i - s < 2 && ((unsigned char)text[s] & 0xC0) == 0x80)
+		s--;
+	auto at = [&](const size_t &j) {
+		return j < text.size() ? (unsigned char)text[j] : 0;
+	};
+	unsigned char lead = at(s);
+	if (lead >= 0xC3 && lead <= 0xDF)
+		return i <= s + 1 && !(lead == 0xC3 && (at(s + 1) == 0x97 || at(s + 1) == 0xB7));
+	if (lead == 0xE1)
+		return (at(s + 1) & 0xC0) == 0x80 && (at(s + 2) & 0xC0) == 0x80;
+	if (lead == 0xE2)
+		return at(s + 1) == 0x80 && (at(s + 2) | 1) == 0x99;
+	return false;
+}
+
+inline const int lowestBit(const uint64_t &m)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(m);
+#else
+	int i = 0;
+	while (!((m >> i) & 1))
+		i++;
+	return i;
+#endif
+}
+
+inline uint64_t classifyScalar(const std::string_view &text, const size_t &base, const size_t &width)
+{
+	uint64_t mask = 0;
+	for (size_t i = 0; i < width; i++)
+		mask |= (uint64_t)isWordByte(text, base + i) << i;
+	return mask;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+// Byte classes of a 64-byte block, one bit per byte.
+struct ByteMasks
+{
+	uint64_t letter = 0;	// ASCII letter or apostrophe
+	uint64_t high = 0;	// 0x80 and up
+	uint64_t lead = 0;	// 0xC3 to 0xDF, leading U+00C0 to U+07FF
+	uint64_t cont = 0;	// 0x80 to 0xBF
+	uint64_t c3 = 0;	// 0xC3
+	uint64_t sign = 0;	// 0x97 or 0xB7, ending × or ÷ after 0xC3
+	uint64_t e1 = 0;	// 0xE1, leading U+1000 to U+1FFF
+	uint64_t e2 = 0;	// 0xE2
+	uint64_t x80 = 0;	// 0x80
+	uint64_t quote = 0;	// 0x98 or 0x99, ending ‘ or ’ after 0xE2 0x80
+};
+
+// The word bytes of a block, reading each character within the block only;
+// bytes 0, 1, 62 and 63 may belong to characters crossing its edges.
+inline uint64_t wordMask(const ByteMasks &m)
+{
+	uint64_t lead = m.lead & ~(m.c3 & (m.sign >> 1));
+	uint64_t three = (m.e1 & (m.cont >> 1) & (m.cont >> 2)) | (m.e2 & (m.x80 >> 1) & (m.quote >> 2));
+	return m.letter | lead | (m.cont & (lead << 1)) | three | (three << 1) | (three << 2);
+}
+#endif
+
+#if defined(__AVX2__)
+inline void classify32(ByteMasks *m, const char *p, const int &shift)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i *)p);
+	__m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+	auto in = [&](const __m256i &x, const uint8_t &lo, const uint8_t &hi) {
+		__m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8((char)lo));
+		__m256i within = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8((char)(hi - lo))), d);
+		return (uint64_t)(uint32_t)_mm256_movemask_epi8(within) << shift;
+	};
+	m->letter |= in(lower, 'a', 'z') | in(v, '\'', '\'');
+	m->high |= (uint64_t)(uint32_t)_mm256_movemask_epi8(v) << shift;
+	m->lead |= in(v, 0xC3, 0xDF);
+	m->cont |= in(v, 0x80, 0xBF);
+	m->c3 |= in(v, 0xC3, 0xC3);
+	m->sign |= in(v, 0x97, 0x97) | in(v, 0xB7, 0xB7);
+	m->e1 |= in(v, 0xE1, 0xE1);
+	m->e2 |= in(v, 0xE2, 0xE2);
+	m->x80 |= in(v, 0x80, 0x80);
+	m->quote |= in(v, 0x98, 0x99);
+}
+
+inline const ByteMasks classifyBytes(const char *p)
+{
+	ByteMasks m;
+	classify32(&m, p, 0);
+	classify32(&m, p + 32, 32);
+	return m;
+}
+#elif defined(__SSE2__)
+inline void classify16(ByteMasks *m, const char *p, const int &shift)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *)p);
+	__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+	auto in = [&](const __m128i &x, const uint8_t &lo, const uint8_t &hi) {
+		__m128i d = _mm_sub_epi8(x, _mm_set1_epi8((char)lo));
+		__m128i within = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8((char)(hi - lo))), d);
+		return (uint64_t)(uint32_t)_mm_movemask_epi8(within) << shift;
+	};
+	m->letter |= in(lower, 'a', 'z') | in(v, '\'', '\'');
+	m->high |= (uint64_t)(uint32_t)_mm_movemask_epi8(v) << shift;
+	m->lead |= in(v, 0xC3, 0xDF);
+	m->cont |= in(v, 0x80, 0xBF);
+	m->c3 |= in(v, 0xC3, 0xC3);
+	m->sign |= in(v, 0x97, 0x97) | in(v, 0xB7, 0xB7);
+	m->e1 |= in(v, 0xE1, 0xE1);
+	m->e2 |= in(v, 0xE2, 0xE2);
+	m->x80 |= in(v, 0x80, 0x80);
+	m->quote |= in(v, 0x98, 0x99);
+}
+
+inline const ByteMasks classifyBytes(const char *p)
+{
+	ByteMasks m;
+	for (int i = 0; i < 64; i += 16)
+		classify16(&m, p + i, i);
+	return m;
+}
+#endif
+
+// The word bytes of text[base, base + 64).
+inline uint64_t classifyBlock(const std::string_view &text, const size_t &base)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+	ByteMasks m = classifyBytes(text.data() + base);
+	uint64_t mask = wordMask(m);
+	uint64_t edges = m.high & 0xC000000000000003ull;
+	while (edges) {
+		int b = lowestBit(edges);
+		edges &= edges - 1;
+		mask = (mask & ~((uint64_t)1 << b)) | (uint64_t)isWordByte(text, base + b) << b;
+	}
+	return mask;
+#else
+	return classifyScalar(text, base, 64);
+#endif
+}
+
+// The length of the apostrophe, straight or curly, that t starts with; 0 if
+// none.
+inline const size_t leadingApostrophe(const std::string_view &t)
+{
+	if (!t.empty() && t.front() == '\'')
+		return 1;
+	if (t.size() >= 3 && (unsigned char)t[0] == 0xE2 && (unsigned char)t[1] == 0x80 && ((unsigned char)t[2] | 1) == 0x99)
+		return 3;
+	return 0;
+}
+
+inline const size_t trailingApostrophe(const std::string_view &t)
+{
+	if (!t.empty() && t.back() == '\'')
+		return 1;
+	if (t.size() >= 3 && leadingApostrophe(t.substr(t.size() - 3)) == 3)
+		return 3;
+	return 0;
+}
+
+// Strips apostrophes used as quotation marks around a token.
+inline const std::string_view trimToken(std::string_view t)
+{
+	while (size_t n = leadingApostrophe(t))
+		t.remove_prefix(n);
+	while (size_t n = trailingApostrophe(t))
+		t.remove_suffix(n);
+	return t;
+}
+
+/*
+ * Calls emit(std::string_view) for every token of text and returns the number
+ * of bytes consumed. Unless final is set, what follows the last break byte of
+ * text, where a token or a character may run into the next chunk, is left
+ * unconsumed so that the caller can carry it over.
+ */
+template<typename F>
+size_t tokenize(const std::string_view &text, F &&emit, const bool &final = true)
+{
+	const char *data = text.data();
+	size_t n = text.size();
+	// What follows the last break byte may run on into the next chunk.
+	if (!final) {
+		while (n > 0 && !isBreakByte(data[n - 1]))
+			n--;
+	}
+	const std::string_view whole(data, n);
+	size_t start = 0;
+	bool inside = false;
+	size_t i = 0;
+	auto edges = [&](uint64_t mask, const size_t &base, const size_t &width) {
+		// a set bit in edge marks a byte whose class differs from the one before it
+		uint64_t prev = (mask << 1) | (inside ? 1 : 0);
+		uint64_t edge = mask ^ prev;
+		if (width < 64)
+			edge &= ((uint64_t)1 << width) - 1;
+		while (edge) {
+			int b = lowestBit(edge);
+			edge &= edge - 1;
+			if (!inside) {
+				start = base + b;
+			} else {
+				auto t = trimToken(std::string_view(data + start, base + b - start));
+				if (!t.empty())
+					emit(t);
+			}
+			inside = !inside;
+		}
+	};
+	for (; i + 64 <= n; i += 64)
+		edges(classifyBlock(whole, i), i, 64);
+	if (i < n)
+		edges(classifyScalar(whole, i, n - i), i, n - i);
+	if (!inside)
+		return n;
+	if (!final)
+		return start;
+	auto t = trimToken(std::string_view(data + start, n - start));
+	if (!t.empty())
+		emit(t);
+	return n;
+}
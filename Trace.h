@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+
+/*
+ * Scoped phase timers, written out as a Chrome trace (the JSON object format
+ * that chrome://tracing and Perfetto open). Every thread records into its own
+ * buffer and shows up as its own track. Timing is only compiled in with
+ * -DLEMMA_TRACE; otherwise TRACE_SCOPE and TRACE_THREAD expand to nothing and
+ * writeTrace fails.
+ *
+ *	TRACE_SCOPE("name")	times the rest of the enclosing block
+ *	TRACE_THREAD("name")	names the calling thread's track
+ */
+
+#ifdef LEMMA_TRACE
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct TraceEvent
+{
+	const char *name;
+	uint64_t start;
+	uint64_t duration;
+};
+
+struct TraceBuffer
+{
+	uint32_t tid;
+	std::string name;
+	std::vector<TraceEvent> events;
+};
+
+// Buffers are owned here rather than by their threads, so that they outlive
+// worker threads until the trace is written.
+struct TraceLog
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<TraceBuffer>> buffers;
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+inline TraceLog &traceLog()
+{
+	static TraceLog log;
+	return log;
+}
+
+inline TraceBuffer &traceBuffer()
+{
+	thread_local TraceBuffer *buffer = [] {
+		auto &log = traceLog();
+		std::lock_guard<std::mutex> lock(log.mutex);
+		log.buffers.push_back(std::make_unique<TraceBuffer>());
+		log.buffers.back()->tid = log.buffers.size();
+		return log.buffers.back().get();
+	}();
+	return *buffer;
+}
+
+// Nanoseconds since the trace log was created.
+inline const uint64_t traceNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceLog().epoch).count();
+}
+
+struct TraceScope
+{
+	const char *name;
+	uint64_t start;
+
+	TraceScope(const char *name) : name(name), start(traceNow())
+	{}
+
+	~TraceScope()
+	{
+		traceBuffer().events.push_back({ name, start, traceNow() - start });
+	}
+};
+
+// Only call once every traced thread has finished.
+inline const bool writeTrace(const std::string &filename)
+{
+	std::ofstream out(filename);
+	if (!out.is_open())
+		return false;
+	auto &log = traceLog();
+	std::lock_guard<std::mutex> lock(log.mutex);
+	// timestamps are in microseconds
+	out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+	bool first = true;
+	auto separate = [&] {
+		if (!first)
+			out << ",\n";
+		first = false;
+	};
+	for (auto &b : log.buffers) {
+		separate();
+		out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << b->tid
+			<< ",\"args\":{\"name\":\"" << (b->name.empty() ? "thread " + std::to_string(b->tid) : b->name) << "\"}}";
+		for (auto &e : b->events) {
+			separate();
+			out << "{\"ph\":\"X\",\"name\":\"" << e.name << "\",\"pid\":1,\"tid\":" << b->tid
+				<< ",\"ts\":" << e.start / 1000.0 << ",\"dur\":" << e.duration / 1000.0 << "}";
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+	return true;
+}
+
+#define TRACE_JOIN2(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN2(a, b)
+#define TRACE_SCOPE(label) TraceScope TRACE_JOIN(trace_, __LINE__)(label)
+#define TRACE_THREAD(label) (traceBuffer().name = (label))
+
+#else
+
+#define TRACE_SCOPE(label)
+#define TRACE_THREAD(label)
+
+inline const bool writeTrace(const std::string &)
+{
+	return false;
+}
+
+#endif